@@ -4,6 +4,7 @@
 #include <iostream>
 
 #include <random>
+#include <thread>
 
 #include "generators/linear_congruential_generator.hpp"
 #include "generators/mersenne_twister.hpp"
@@ -214,6 +215,57 @@ void benchmark_generate_array_avx2_vs_avx512(size_t count_number) {
 }
 #endif
 
+void benchmark_linear_complexity(size_t count_number) {
+    MT19937 generator;
+    std::vector<uint32_t> numbers(count_number);
+    for (size_t i = 0; i < count_number; i++) {
+        numbers[i] = generator();
+    }
+    utils::seq_bytes bytes = utils::convert_numbers_to_seq_bytes(numbers);
+    for (size_t M : {500, 1000, 5000}) {
+        auto begin = std::chrono::steady_clock::now();
+        std::double_t p_word = nist::linear_complexity(bytes, M, nist::LinearComplexityEngine::WordParallel);
+        auto elapsed =
+            std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin).count();
+        std::cout << "Linear complexity M = " << M << " word-parallel: " << elapsed << " ms" << std::endl;
+
+        begin = std::chrono::steady_clock::now();
+        std::double_t p_sliced = nist::linear_complexity(bytes, M, nist::LinearComplexityEngine::BitSliced);
+        elapsed =
+            std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin).count();
+        std::cout << "Linear complexity M = " << M << " bit-sliced: " << elapsed << " ms" << std::endl;
+
+        if (p_word != p_sliced) {
+            std::cout << "M = " << M << " Diff p-value " << p_word << " != " << p_sliced << std::endl;
+        }
+    }
+}
+
+void benchmark_discrete_fourier_transform_scaling(size_t count_number) {
+    MT19937 generator;
+    std::vector<uint32_t> numbers(count_number);
+    for (size_t i = 0; i < count_number; i++) {
+        numbers[i] = generator();
+    }
+    utils::seq_bytes bytes = utils::convert_numbers_to_seq_bytes(numbers);
+    const size_t max_threads = std::max(std::thread::hardware_concurrency(), 1U);
+    std::int64_t single = 0;
+    for (size_t threads = 1; threads <= max_threads; ++threads) {
+        utils::ThreadPool::set_global_threads(threads);
+        auto begin = std::chrono::steady_clock::now();
+        std::double_t p_value = nist::discrete_fourier_transform(bytes);
+        auto elapsed =
+            std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin).count();
+        if (threads == 1) {
+            single = elapsed;
+        }
+        std::cout << "DFT " << bytes.size() << " bits, " << threads << " threads: " << elapsed << " ms, speedup "
+                  << static_cast<std::double_t>(single) / std::max<std::int64_t>(elapsed, 1) << ", p = " << p_value
+                  << std::endl;
+    }
+    utils::ThreadPool::set_global_threads(max_threads);
+}
+
 int main() {
     std::size_t count_number = 100'000'000;
 
@@ -235,6 +287,9 @@ int main() {
     // benchmark_generate_array_avx2_vs_avx512(count_number);
 #endif
 
+    // benchmark_linear_complexity(count_number / 100);
+    // benchmark_discrete_fourier_transform_scaling(1 << 21);
+
     // const size_t count_number = 32768;
     // const size_t count_tests = 1000;
     // const std::double_t alpha = 1.0 / count_tests;
@@ -1,10 +1,30 @@
 #pragma once
 
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
 #include "indicators.hpp"
+#include "metrics/thread_pool.hpp"
+
+template <typename Generator>
+utils::seq_bytes generate_sequence(const size_t count_number, const uint32_t seed) {
+    Generator generator(seed);
+    std::vector<typename Generator::result_type> numbers(count_number);
+    for (size_t j = 0; j < count_number; ++j) {
+        numbers[j] = generator();
+    }
+    utils::seq_bytes bytes = utils::convert_numbers_to_seq_bytes(numbers);
+    assert(bytes.size() == count_number * std::numeric_limits<typename Generator::result_type>::digits);
+    return bytes;
+}
 
+// Seeds are split into contiguous chunks, one per task of the global thread pool. Every task owns its generators and
+// a test accumulator, and the accumulators are merged in seed order, so the statistics do not depend on the number of
+// threads. threads = 0 uses one chunk per thread of the pool
 template <typename StatisticalTest, typename Generator>
 void run_statistical_test(const std::string &generator_name, const size_t count_tests, const size_t count_number,
-                          const uint32_t start_seed = 0u, const std::double_t alpha = 0.01) {
+                          const uint32_t start_seed = 0u, const std::double_t alpha = 0.01, size_t threads = 0) {
     std::float_t progress = 0.0f;
     const std::float_t step_size = 100.0f / count_tests;
 
@@ -21,23 +41,31 @@ void run_statistical_test(const std::string &generator_name, const size_t count_
         indicators::option::ShowElapsedTime{true},
         indicators::option::FontStyles{std::vector<indicators::FontStyle>{indicators::FontStyle::bold}}};
 
-    StatisticalTest test(alpha);
-    for (size_t i = 0; i < count_tests; ++i) {
-        Generator generator(start_seed + i);
-        std::vector<typename Generator::result_type> numbers(count_number);
-        for (size_t j = 0; j < count_number; ++j) {
-            numbers[j] = generator();
-        }
-        utils::seq_bytes bytes = utils::convert_numbers_to_seq_bytes(numbers);
-        assert(bytes.size() == count_number * std::numeric_limits<typename Generator::result_type>::digits);
-        test.test(bytes);
-        progress += step_size;
-        bar.set_progress(progress);
+    if (threads == 0) {
+        threads = utils::ThreadPool::global().size();
+    }
+    threads = std::max<size_t>(1, std::min(threads, count_tests));
+    std::vector<StatisticalTest> tests(threads, StatisticalTest(alpha));
+    std::mutex progress_mutex;
+    utils::TaskGroup group;
+    for (size_t t = 0; t < threads; ++t) {
+        group.run([&, t] {
+            for (size_t i = count_tests * t / threads; i < count_tests * (t + 1) / threads; ++i) {
+                tests[t].test(generate_sequence<Generator>(count_number, start_seed + i));
+                std::lock_guard<std::mutex> lock(progress_mutex);
+                progress += step_size;
+                bar.set_progress(progress);
+            }
+        });
     }
+    group.wait();
     bar.mark_as_completed();
     indicators::show_console_cursor(true);
 
-    test.print_statistics(generator_name);
+    for (size_t t = 1; t < threads; ++t) {
+        tests[0].merge(tests[t]);
+    }
+    tests[0].print_statistics(generator_name);
 }
 
 template <typename StatisticalTest, typename Generator>
@@ -45,14 +73,7 @@ void run_statistical_test_without_progress_bar(const std::string &generator_name
                                                const size_t count_number, const uint32_t start_seed = 0u) {
     StatisticalTest test;
     for (size_t i = 0; i < count_tests; ++i) {
-        Generator generator(start_seed + i);
-        std::vector<typename Generator::result_type> numbers(count_number);
-        for (size_t j = 0; j < count_number; ++j) {
-            numbers[j] = generator();
-        }
-        utils::seq_bytes bytes = utils::convert_numbers_to_seq_bytes(numbers);
-        assert(bytes.size() == count_number * std::numeric_limits<typename Generator::result_type>::digits);
-        test.test(bytes);
+        test.test(generate_sequence<Generator>(count_number, start_seed + i));
         std::cout << "Test " << i + 1 << " of " << count_tests << " completed." << std::endl;
     }
     test.print_statistics(generator_name);
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "metrics/utils.hpp"
+
+namespace utils {
+
+// Linear complexity of the sequence bytes[offset, offset + length)
+size_t berlekamp_massey(const seq_bytes &bytes, size_t offset, size_t length);
+
+// Linear complexity of each of the N consecutive blocks of length M
+std::vector<size_t> berlekamp_massey_blocks(const seq_bytes &bytes, size_t M, size_t N);
+
+// Same as berlekamp_massey_blocks, but runs 64 blocks (512 with AVX-512) in lockstep: bit b of every word belongs
+// to block b, so the data-dependent branches of the algorithm become masked word operations
+std::vector<size_t> berlekamp_massey_blocks_bitsliced(const seq_bytes &bytes, size_t M, size_t N);
+
+} // namespace utils
@@ -1,4 +1,7 @@
+#pragma once
+
 #include <iostream>
+#include <utility>
 
 #include "utils.hpp"
 
@@ -10,19 +13,47 @@ double matrix_rank_prob(int M, int Q, int rank);
 
 double matrix_test(const utils::seq_bytes &bytes, int rows, int cols, int iterations);
 
+// Birthdays of 1 <= days_bits <= 64 bits, the tsamples samples take consecutive num_bdays * days_bits bits
 double birthdays_test(const utils::seq_bytes &bytes, int days_bits, int num_bdays, int tsamples);
 
 double minimum_distance_test(const utils::seq_bytes &bytes, int n_dims, int num_coordinates, int num_samples);
 
 double overlapping_permutations_test(const utils::seq_bytes &bytes, int num_samples);
 
+// Counts of the overlapping 5-letter and 4-letter words of the monkey test, words are base-5 integers
+std::pair<std::vector<size_t>, std::vector<size_t>> base_5_word_counts(const utils::seq_bytes &bytes, int num_samples);
 double base_5_word_chi_sq(const utils::seq_bytes &bytes, int num_samples, int word_length);
 double monkey_test(const utils::seq_bytes &bytes, int num_samples);
+// Count-the-ones tests: the letters of the overlapping words are the counts of ones of consecutive bytes of the
+// sequence (stream) or of the byte at bits first_bit ... first_bit + 7 of consecutive 32-bit integers (byte).
+// count_ones_bytes_test combines the byte tests of first_bit = 0 ... 24 by the KS test
+double count_ones_stream_test(const utils::seq_bytes &bytes, int num_words);
+double count_ones_byte_test(const utils::seq_bytes &bytes, int num_words, int first_bit);
+double count_ones_bytes_test(const utils::seq_bytes &bytes, int num_words);
 
 double squeeze_test(const utils::seq_bytes &bytes, int num_samples);
 
 double sums_test(const utils::seq_bytes &bytes, int num_samples);
 
+// Craps test: every game throws its own pairs of dice, throw t < 64 of game g uses the 64 bits of pair
+// t * num_games + g. Needs at least num_games * 64 * 64 bits, games longer than 64 throws take the pairs after them and
+// throw if the sequence runs out
 double craps_test(const utils::seq_bytes &bytes, int num_games);
 
+// Sparse occupancy tests: every repetition takes 2^21 overlapping 20-bit words made of consecutive letters of the
+// sequence and counts the missing ones of the 2^20 possible words. Letters have 10 bits (2-letter words) for OPSO,
+// 5 bits (4-letter words) for OQSO and 2 bits (10-letter words) for DNA. The p-values of the repetitions are combined
+// by the KS test
+double opso_test(const utils::seq_bytes &bytes, int num_repetitions);
+double oqso_test(const utils::seq_bytes &bytes, int num_repetitions);
+double dna_test(const utils::seq_bytes &bytes, int num_repetitions);
+
+// Parking lot test: every sample tries to park 12000 unit squares at random centers of a 100 x 100 lot, a car crashes
+// into a parked one if both of their coordinates differ by at most 1. The number of parked cars is compared with
+// Marsaglia's mean 3523 and deviation 21.9
+double parking_lot_test(const utils::seq_bytes &bytes, int num_samples);
+// 3D spheres test: every sample takes 4000 random points of a cube of edge 1000, the cube of the distance of the
+// closest pair is exponential with mean 30
+double spheres_3d_test(const utils::seq_bytes &bytes, int num_samples);
+
 } // namespace diehard
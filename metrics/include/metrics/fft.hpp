@@ -0,0 +1,99 @@
+#pragma once
+
+#include <complex>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "metrics/utils.hpp"
+
+namespace utils {
+
+enum class FFTPrecision {
+    Double,
+    Float,
+};
+
+// Forward complex FFT of arbitrary size. Sizes of the form 2^a * 3^b * 5^c use a mixed radix 4/2/3/5 decimation in
+// time, any other size is reduced to a convolution of 2/3/5-smooth size with the Bluestein chirp-z transform.
+template <typename Real>
+class ComplexFFTPlan {
+    size_t size_;
+    std::vector<size_t> factors;
+    // exp(-2 * pi * i * k / size), k < size
+    std::vector<std::complex<Real>> twiddles;
+
+    // Bluestein: chirp_k = exp(-pi * i * k^2 / size), and the spectrum of the conjugated chirp of the inner size
+    std::unique_ptr<const ComplexFFTPlan> inner;
+    std::vector<std::complex<Real>> chirp;
+    std::vector<std::complex<Real>> chirp_spectrum;
+
+    void mixed_radix(std::complex<Real> *out, const std::complex<Real> *in, size_t stride, size_t n,
+                     const size_t *factor) const;
+    void butterfly(std::complex<Real> *out, size_t stride, size_t m, size_t p) const;
+
+  public:
+    explicit ComplexFFTPlan(size_t size);
+
+    static bool is_smooth(size_t size);
+    static size_t next_smooth(size_t size);
+
+    size_t size() const;
+
+    void transform(const std::complex<Real> *in, std::complex<Real> *out) const;
+};
+
+// Real-to-complex FFT of the +-1 sequence 2 * bytes - 1 for a fixed size.
+// For even sizes the n real inputs are packed into n / 2 complex values, so one complex FFT of half the size is
+// enough. Power-of-two sizes use an in-place radix-2 FFT whose twiddle factors are gathered from the split factors and
+// whose bit-reversal permutation is computed once in the constructor, other sizes use ComplexFFTPlan.
+// From blocked_threshold bits on, the radix-2 FFT no longer fits in cache and is replaced by the six-step algorithm:
+// the half-size transform is viewed as a rows x columns matrix, and cache-sized FFTs of its rows and columns run in
+// parallel, separated by blocked transposes.
+template <typename Real>
+class RealFFTPlan {
+    size_t size_;
+    // Length of the complex transform: size / 2 for even sizes and size for odd ones
+    size_t half;
+    // exp(-2 * pi * i * k / size) for the split of the half-size spectrum, k < size / 2. They are also the twiddles
+    // of every radix-2 stage
+    std::vector<std::complex<Real>> split;
+    std::vector<std::uint32_t> bit_reverse;
+    std::unique_ptr<const ComplexFFTPlan<Real>> general;
+
+    // Six-step decomposition half = rows * columns, rows >= columns
+    size_t rows = 0;
+    size_t columns = 0;
+    std::vector<std::uint32_t> row_bit_reverse;
+    std::vector<std::uint32_t> column_bit_reverse;
+    // Twiddles of the row and column FFTs, the stage with half block size m2 in row_twiddles[m2 ... 2 * m2)
+    std::vector<std::complex<Real>> row_twiddles;
+    // exp(-2 * pi * i * e / half) = step_coarse[e / columns] * step_fine[e % columns]
+    std::vector<std::complex<Real>> step_coarse;
+    std::vector<std::complex<Real>> step_fine;
+
+    void transform_half(const seq_bytes &bytes, std::vector<std::complex<Real>> &z) const;
+    void transform_six_step(const seq_bytes &bytes, std::vector<std::complex<Real>> &z) const;
+
+  public:
+    static constexpr size_t blocked_threshold = size_t(1) << 23;
+
+    explicit RealFFTPlan(size_t size);
+
+    static constexpr size_t cached_plans = 4;
+
+    // Plans of the cached_plans most recently used sizes are cached, so repeated tests of the same length reuse them
+    static std::shared_ptr<const RealFFTPlan> get(size_t size);
+
+    static bool supports(size_t size);
+
+    size_t size() const;
+
+    // First size / 2 DFT coefficients
+    std::vector<std::complex<Real>> transform(const seq_bytes &bytes) const;
+
+    // Number of the first size / 2 DFT coefficients with magnitude below threshold, without storing the spectrum
+    size_t count_below(const seq_bytes &bytes, Real threshold) const;
+};
+
+} // namespace utils
@@ -1,16 +1,22 @@
+#pragma once
+
 #include <iostream>
 
+#include "fft.hpp"
+#include "sequence_analysis.hpp"
 #include "utils.hpp"
 
 namespace nist {
 
 double frequency_test(const utils::seq_bytes &bytes);
+double frequency_test(const utils::SequenceAnalysis &analysis);
 bool check_frequency_test(const utils::seq_bytes &bytes);
 
 double frequency_block_test(const utils::seq_bytes &bytes, size_t m);
 bool check_frequency_block_test(const utils::seq_bytes &bytes, size_t m);
 
 double runs_test(const utils::seq_bytes &bytes);
+double runs_test(const utils::SequenceAnalysis &analysis);
 bool check_runs_test(const utils::seq_bytes &bytes);
 
 double longest_run_of_ones(const utils::seq_bytes &bytes);
@@ -19,29 +25,49 @@ bool check_longest_run_of_ones(const utils::seq_bytes &bytes);
 double binary_matrix_rank(const utils::seq_bytes &bytes, size_t M, size_t Q);
 bool check_binary_matrix_rank(const utils::seq_bytes &bytes, size_t M, size_t Q);
 
-double discrete_fourier_transform(const utils::seq_bytes &bytes);
-bool check_discrete_fourier_transform(const utils::seq_bytes &bytes);
+double discrete_fourier_transform(const utils::seq_bytes &bytes,
+                                  utils::FFTPrecision precision = utils::FFTPrecision::Double);
+bool check_discrete_fourier_transform(const utils::seq_bytes &bytes,
+                                      utils::FFTPrecision precision = utils::FFTPrecision::Double);
 
 double non_overlapping_template_matching(const utils::seq_bytes &bytes, const utils::seq_bytes &template_,
                                          size_t N = 8);
 bool check_non_overlapping_template_matching(const utils::seq_bytes &bytes, const utils::seq_bytes &template_,
                                              size_t N = 8);
 
+// p-values for each of the templates of the same length m <= 16, found in one pass over every block
+std::vector<double> non_overlapping_template_matching(const utils::seq_bytes &bytes,
+                                                      const std::vector<utils::seq_bytes> &templates, size_t N = 8);
+
+// All m-bit templates that can not overlap with themselves, in ascending order; 148 templates for m = 9
+std::vector<utils::seq_bytes> aperiodic_templates(size_t m);
+
+// N = 0 uses all n / M complete blocks of the sequence, a larger N is clamped to n / M
 double overlapping_template_matching(const utils::seq_bytes &bytes, const utils::seq_bytes &template_, size_t M = 1032,
                                      size_t N = 968, size_t K = 5, bool test = false);
 bool check_overlapping_template_matching(const utils::seq_bytes &bytes, const utils::seq_bytes &template_,
                                          size_t M = 1032, size_t N = 968, size_t K = 5, bool test = false);
 
 double universal(const utils::seq_bytes &bytes);
+double universal(const utils::SequenceAnalysis &analysis);
 bool check_universal(const utils::seq_bytes &bytes);
 
-double linear_complexity(const utils::seq_bytes &bytes, size_t M);
-bool check_linear_complexity(const utils::seq_bytes &bytes, size_t M);
+enum LinearComplexityEngine {
+    WordParallel,
+    BitSliced,
+};
+
+double linear_complexity(const utils::seq_bytes &bytes, size_t M,
+                         LinearComplexityEngine engine = LinearComplexityEngine::WordParallel);
+bool check_linear_complexity(const utils::seq_bytes &bytes, size_t M,
+                             LinearComplexityEngine engine = LinearComplexityEngine::WordParallel);
 
 std::pair<double, double> serial_complexity(const utils::seq_bytes &bytes, size_t m);
+std::pair<double, double> serial_complexity(const utils::SequenceAnalysis &analysis, size_t m);
 bool check_serial_complexity(const utils::seq_bytes &bytes, size_t m);
 
 double approximate_entropy(const utils::seq_bytes &bytes, size_t m);
+double approximate_entropy(const utils::SequenceAnalysis &analysis, size_t m);
 bool check_approximate_entropy(const utils::seq_bytes &bytes, size_t m);
 
 enum CumulativeSumsMode {
@@ -50,6 +76,8 @@ enum CumulativeSumsMode {
 };
 
 double cumulative_sums(const utils::seq_bytes &bytes, CumulativeSumsMode mode);
+// p-values of the forward and the reverse mode from one pass over the sequence
+std::pair<double, double> cumulative_sums(const utils::seq_bytes &bytes);
 bool check_cumulative_sums(const utils::seq_bytes &bytes, CumulativeSumsMode mode);
 
 std::vector<double> random_excursions(const utils::seq_bytes &bytes, bool check = true);
@@ -58,4 +86,8 @@ std::vector<bool> check_random_excursions(const utils::seq_bytes &bytes, bool ch
 std::vector<double> random_excursions_variant(const utils::seq_bytes &bytes, bool check = true);
 std::vector<bool> check_random_excursions_variant(const utils::seq_bytes &bytes, bool check = true);
 
+// p-values of both random excursions tests from one walk over the sequence
+std::pair<std::vector<double>, std::vector<double>> random_excursions_and_variant(const utils::seq_bytes &bytes,
+                                                                                  bool check = true);
+
 } // namespace nist
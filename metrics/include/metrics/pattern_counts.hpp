@@ -0,0 +1,17 @@
+#pragma once
+
+#include <vector>
+
+#include "metrics/utils.hpp"
+
+namespace utils {
+
+// Number of occurrences of every m-bit pattern among the n overlapping windows of the sequence, where the windows at
+// the end wrap around to its beginning. Pattern b_1 ... b_m is stored at index b_1 * 2^{m-1} + ... + b_m.
+std::vector<size_t> overlapping_pattern_counts(const seq_bytes &bytes, size_t m);
+
+// Counts of (m - 1)-bit patterns from the counts of m-bit patterns: with wraparound every (m - 1)-bit window is the
+// prefix of exactly one m-bit window, so count[v] = counts[2v] + counts[2v + 1]
+std::vector<size_t> marginalize_pattern_counts(const std::vector<size_t> &counts);
+
+} // namespace utils
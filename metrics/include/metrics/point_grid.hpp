@@ -0,0 +1,80 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace utils {
+
+// Points of the cube [0, side)^Dims bucketed into cells^Dims cells of a uniform grid by a counting sort.
+// Coordinates outside the cube are clamped to its border cells
+template <size_t Dims>
+class PointGrid {
+  public:
+    using Point = std::array<double, Dims>;
+
+  private:
+    size_t cells_;
+    double cell_width_;
+    // Points of cell c are sorted[cell_start[c] ... cell_start[c + 1])
+    std::vector<size_t> cell_start;
+    std::vector<Point> sorted;
+
+    size_t cell_index(const Point &point) const;
+
+  public:
+    PointGrid(const std::vector<Point> &points, double side, size_t cells);
+
+    size_t cells() const;
+    double cell_width() const;
+
+    // Squared distance of the closest pair of points lying in the same or adjacent cells, infinity if there is none.
+    // It is the exact closest pair whenever the result is at most cell_width()^2
+    double closest_pair_squared() const;
+};
+
+// Norm of the distance between two points
+enum class Norm { euclidean, maximum };
+
+// Points of the cube [0, side)^Dims inserted one at a time into cells^Dims cells of a uniform grid, every cell keeps a
+// linked list of its points. Coordinates outside the cube are clamped to its border cells
+template <size_t Dims>
+class IncrementalPointGrid {
+  public:
+    using Point = std::array<double, Dims>;
+
+  private:
+    size_t cells_;
+    double cell_width_;
+    // The last point inserted into every cell and the point inserted into the same cell before every point,
+    // npos for none
+    std::vector<size_t> head;
+    std::vector<size_t> next;
+    std::vector<Point> points;
+    // Offsets of the 3^Dims cells around a cell, as the delta of the cell index and of every coordinate index
+    std::vector<std::pair<std::ptrdiff_t, std::array<int, Dims>>> offsets;
+
+    std::array<size_t, Dims> cell_coordinates(const Point &point) const;
+
+  public:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    IncrementalPointGrid(double side, size_t cells);
+
+    size_t size() const;
+    double cell_width() const;
+
+    // Whether an inserted point lies within distance of point. Only the same and adjacent cells are searched, so
+    // distance must not exceed cell_width()
+    bool has_point_within(const Point &point, double distance, Norm norm = Norm::euclidean) const;
+    void insert(const Point &point);
+};
+
+// Squared distance of the closest pair of at least two points of [0, side)^Dims. About one point per cell of a uniform
+// grid gives expected linear time for uniform points, a sweep over points sorted by the first coordinate handles
+// the rare inputs where the grid cannot prove the result
+template <size_t Dims>
+double closest_pair_squared(const std::vector<std::array<double, Dims>> &points, double side);
+
+} // namespace utils
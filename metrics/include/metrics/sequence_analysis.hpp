@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include "metrics/utils.hpp"
+
+namespace utils {
+
+// Representations of one sequence shared by the tests that run on it. Every artifact is computed on first use and
+// kept until it is released, so a caller that knows the last consumer of an artifact can drop it early.
+// The sequence itself must outlive the analysis. Artifacts may be requested from several threads at once.
+class SequenceAnalysis {
+    const seq_bytes &bytes_;
+
+    mutable std::mutex mutex;
+    mutable std::optional<size_t> ones_;
+    mutable std::vector<std::uint64_t> packed_bits_;
+    // m -> counts of the overlapping m-bit patterns, see overlapping_pattern_counts
+    mutable std::map<size_t, std::vector<size_t>> pattern_counts_;
+
+  public:
+    explicit SequenceAnalysis(const seq_bytes &bytes);
+
+    const seq_bytes &bytes() const;
+    size_t size() const;
+
+    // Number of ones in the sequence
+    size_t ones() const;
+
+    // The sequence packed by pack_bits
+    const std::vector<std::uint64_t> &packed_bits() const;
+    void release_packed_bits();
+
+    // Counts of the overlapping m-bit patterns. Lower orders are marginalized from the nearest cached higher one, so
+    // requesting the highest order first makes the others cheap
+    const std::vector<size_t> &pattern_counts(size_t m) const;
+    void release_pattern_counts();
+};
+
+} // namespace utils
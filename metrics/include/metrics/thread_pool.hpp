@@ -0,0 +1,126 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace utils {
+
+// Work-stealing pool shared by every parallel path of the project. Every worker owns a deque: it pushes and pops its
+// own tasks at the back and steals from the front of the others, tasks submitted from other threads go to a shared
+// queue. A thread waiting for its tasks runs pending tasks instead of blocking, so nested fork-join (seeds x tests x
+// blocks) keeps exactly size() threads busy.
+class ThreadPool {
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    // One queue per worker and the shared queue last
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+
+    std::mutex sleep_mutex;
+    std::condition_variable wake;
+    size_t queued = 0;
+    bool stopping = false;
+
+    void worker_loop(size_t index);
+    bool pop(Queue &queue, bool back, std::function<void()> &task);
+
+  public:
+    // threads counts the calling thread, which works while it waits, so threads - 1 workers are started
+    explicit ThreadPool(size_t threads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    // Pool of std::thread::hardware_concurrency() threads used by the tests
+    static ThreadPool &global();
+    // Replaces the global pool, must not be called while it runs tasks
+    static void set_global_threads(size_t threads);
+
+    size_t size() const;
+
+    void submit(std::function<void()> task);
+    // Runs one pending task, if any, on the calling thread
+    bool run_pending_task();
+
+    // Calls body(begin, end) for consecutive chunks of [0, count) of at least grain indices and waits for them.
+    // Chunk boundaries depend on size(), so reductions over chunks must not depend on their order
+    template <typename Body>
+    void parallel_for(size_t count, Body &&body, size_t grain = 1);
+};
+
+// Fork-join group: tasks run on the pool and wait() runs pending tasks until all of them are done.
+// The first exception of the tasks is rethrown by wait()
+class TaskGroup {
+    ThreadPool &pool;
+    std::atomic<size_t> pending = 0;
+    std::mutex mutex;
+    std::condition_variable done;
+    std::exception_ptr exception;
+
+  public:
+    explicit TaskGroup(ThreadPool &pool = ThreadPool::global());
+    ~TaskGroup();
+
+    void run(std::function<void()> task);
+    void wait();
+};
+
+// Tasks with dependencies. A task starts when all tasks it depends on are finished, ready tasks start in the order
+// they were added
+class TaskGraph {
+    struct Node {
+        std::function<void()> task;
+        std::vector<size_t> successors;
+        size_t dependencies = 0;
+    };
+
+    std::vector<Node> nodes;
+
+  public:
+    // Returns the id of the task, dependencies are ids of tasks added before
+    size_t add(std::function<void()> task, const std::vector<size_t> &dependencies = {});
+
+    // Runs at most max_concurrency tasks at once, 0 means no limit. The first exception of the tasks is rethrown
+    // after all of them are finished
+    void run(size_t max_concurrency = 0, ThreadPool &pool = ThreadPool::global());
+};
+
+template <typename Body>
+void ThreadPool::parallel_for(size_t count, Body &&body, size_t grain) {
+    grain = std::max<size_t>(grain, 1);
+    // A few chunks per thread balance blocks of different cost
+    size_t chunks = std::min((count + grain - 1) / grain, 4 * size());
+    if (chunks <= 1) {
+        if (count != 0) {
+            body(size_t(0), count);
+        }
+        return;
+    }
+    TaskGroup group(*this);
+    for (size_t c = 1; c < chunks; ++c) {
+        group.run([&body, count, chunks, c] { body(count * c / chunks, count * (c + 1) / chunks); });
+    }
+    body(size_t(0), count / chunks);
+    group.wait();
+}
+
+// parallel_for on the global pool
+template <typename Body>
+void parallel_for(size_t count, Body &&body, size_t grain = 1) {
+    ThreadPool::global().parallel_for(count, std::forward<Body>(body), grain);
+}
+
+} // namespace utils
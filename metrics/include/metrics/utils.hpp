@@ -1,14 +1,18 @@
 #pragma once
 
+#include <array>
 #include <bitset>
 #include <complex>
+#include <cstdint>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <limits>
 #include <numbers>
-#include <omp.h>
 #include <vector>
 
+#include "metrics/thread_pool.hpp"
+
 namespace utils {
 
 using seq_bytes = std::vector<unsigned char>;
@@ -50,15 +54,16 @@ std::vector<std::complex<std::double_t>> DFT(const std::vector<T> &x) {
     size_t size = x.size();
     const std::double_t two_pi_over_size = 2 * std::numbers::pi / size;
     std::vector<std::complex<std::double_t>> result(size);
-#pragma omp parallel for
-    for (size_t i = 0; i < size; ++i) {
-        const std::double_t delta = two_pi_over_size * i;
-        std::complex<std::double_t> sum(0.0, 0.0);
-        for (size_t j = 0; j < size; ++j) {
-            sum += std::polar<std::double_t>(1, delta * j) * (std::double_t)x[j];
+    parallel_for(size, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i) {
+            const std::double_t delta = two_pi_over_size * i;
+            std::complex<std::double_t> sum(0.0, 0.0);
+            for (size_t j = 0; j < size; ++j) {
+                sum += std::polar<std::double_t>(1, delta * j) * (std::double_t)x[j];
+            }
+            result[i] = sum;
         }
-        result[i] = sum;
-    }
+    });
     return result;
 }
 
@@ -125,35 +130,69 @@ std::vector<std::complex<std::double_t>> FFT(const std::vector<T> &x) {
 double chi_square(std::vector<double> trial_vector, std::vector<double> expected_vector, int degrees_of_freedom);
 double p_value(int degrees_of_freedom, double chi_square);
 double poissonian(int k, double lambda);
-std::vector<double> bits_to_doubles(const seq_bytes &bytes, int num_floats);
-std::vector<double> random_doubles(int num_doubles);
+// Bit order of the integers read from a sequence
+enum class BitOrder { lsb_first, msb_first };
+// Doubles of [0, 1) made of the 52 highest bits of consecutive 64-bit integers of bits_to_uint
+std::vector<double> bits_to_doubles(const seq_bytes &bytes, int num_floats, BitOrder order = BitOrder::lsb_first);
+// Packs the sequence into 64-bit words, bytes[64 * w] is the most significant bit of word w. One zero word is
+// appended, so any 64-bit window starting inside the sequence can be read from two adjacent words
+std::vector<std::uint64_t> pack_bits(const seq_bytes &bytes);
+// pack_bits of the first count bits of the sequence
+std::vector<std::uint64_t> pack_bits(const seq_bytes &bytes, size_t count);
+
+// The width <= 64 bits of packed bits starting at bit offset, the first of them is the most significant one
+inline std::uint64_t packed_window(const std::vector<std::uint64_t> &words, size_t offset, size_t width) {
+    size_t w = offset / 64;
+    size_t shift = offset % 64;
+    std::uint64_t window = words[w] << shift;
+    if (shift != 0) {
+        window |= words[w + 1] >> (64 - shift);
+    }
+    return width == 64 ? window : window >> (64 - width);
+}
 double kstest(std::vector<double> p_values);
-int kperm(const std::vector<int> &v);
+int kperm(std::array<int, 5> w);
+
+// The 8 bytes holding 0 or 1 starting at bits gathered into one byte, the first of them into its highest bit for
+// msb_first and into its lowest bit for lsb_first. One multiplication moves every byte to its own bit of the top byte
+inline std::uint8_t gather_bits(const std::uint8_t *bits, BitOrder order) {
+    std::uint64_t group;
+    std::memcpy(&group, bits, sizeof(group));
+    const std::uint64_t magic = order == BitOrder::msb_first ? 0x8040201008040201ULL : 0x0102040810204080ULL;
+    return static_cast<std::uint8_t>((group * magic) >> 56);
+}
 
+// The integer made of the bits offset ... offset + 8 * sizeof(UIntType) - 1, the first of them is its lowest bit for
+// lsb_first and its highest bit for msb_first
 template <class UIntType>
-UIntType bits_to_uint(const seq_bytes &bytes, size_t offset) {
+UIntType bits_to_uint(const seq_bytes &bytes, size_t offset, BitOrder order = BitOrder::lsb_first) {
     static_assert(std::is_integral_v<UIntType> && std::is_unsigned_v<UIntType>);
 
-    constexpr size_t bits = sizeof(UIntType) * 8;
-    std::bitset<bits> bitset;
-
-    for (size_t i = 0; i < bits; i++) {
-        bitset[i] = bytes[offset + i];
+    constexpr size_t groups = sizeof(UIntType);
+    std::uint64_t value = 0;
+    for (size_t g = 0; g < groups; ++g) {
+        const std::uint64_t byte = gather_bits(bytes.data() + offset + 8 * g, order);
+        value |= order == BitOrder::msb_first ? byte << (8 * (groups - 1 - g)) : byte << (8 * g);
     }
-
-    return static_cast<UIntType>(bitset.to_ulong());
+    return static_cast<UIntType>(value);
 }
 
+// Consecutive integers of bits_to_uint
 template <class UIntType>
-std::vector<UIntType> bits_to_vector_uint(const seq_bytes &bytes, int size) {
+std::vector<UIntType> bits_to_vector_uint(const seq_bytes &bytes, int size, BitOrder order = BitOrder::lsb_first) {
     static_assert(std::is_integral_v<UIntType> && std::is_unsigned_v<UIntType>);
 
     std::vector<UIntType> result(size);
     size_t bits_per_element = sizeof(UIntType) * 8;
 
-    for (size_t i = 0; i < size; i++) {
-        result[i] = bits_to_uint<UIntType>(bytes, bits_per_element * i);
-    }
+    parallel_for(
+        result.size(),
+        [&](size_t first, size_t last) {
+            for (size_t i = first; i < last; i++) {
+                result[i] = bits_to_uint<UIntType>(bytes, bits_per_element * i, order);
+            }
+        },
+        1 << 14);
     return result;
 }
 
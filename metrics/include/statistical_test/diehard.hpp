@@ -8,9 +8,12 @@
 
 namespace statistical_test {
 
+// min 20'971'530 bits = 2'621'442 bytes, the OPSO test reads (2^21 + 1) 10-bit letters
 class DiehardTest : private StatisticalTest {
 
-    static constexpr std::array<std::string_view, 10> test_names = {"Runs test",
+    static constexpr size_t min_bits = ((size_t(1) << 21) + 1) * 10;
+
+    static constexpr std::array<std::string_view, 17> test_names = {"Runs test",
                                                                     "Matrix test",
                                                                     "Birthdays test",
                                                                     "Minimum distance test",
@@ -19,15 +22,28 @@ class DiehardTest : private StatisticalTest {
                                                                     "Monkey test",
                                                                     "Squeeze test",
                                                                     "Sums test",
-                                                                    "Craps test"};
+                                                                    "Craps test",
+                                                                    "OPSO test",
+                                                                    "OQSO test",
+                                                                    "DNA test",
+                                                                    "Parking lot test",
+                                                                    "3D spheres test",
+                                                                    "Count the ones test (stream)",
+                                                                    "Count the ones test (bytes)"};
 
-    std::array<size_t, 10> test_success;
+    std::array<size_t, 17> test_success;
 
   public:
     DiehardTest(const double &alpha = 0.01f);
 
     void test(const utils::seq_bytes &bytes, const bool &print_p_values = false) override;
 
+    // Appends the results of other as if its sequences were tested after the sequences of this test
+    void merge(const DiehardTest &other);
+
+    // Whether both tests have the same results
+    bool operator==(const DiehardTest &other) const;
+
     void print_statistics(const std::string &generator_name) const override;
 };
 
@@ -3,6 +3,7 @@
 #include <array>
 #include <string>
 #include <string_view>
+#include <utility>
 #include <vector>
 
 #include "metrics/nist_tests.hpp"
@@ -13,7 +14,7 @@ namespace statistical_test {
 // min 1'000'000'000 bits = 125'000'000 bytes
 class NistTest : private StatisticalTest {
 
-    static constexpr std::array<std::string_view, 40> test_names = {
+    static constexpr std::array<std::string_view, 41> base_test_names = {
         "Frequency Test",
         "Frequency Block Test",
         "Runs Test",
@@ -27,7 +28,8 @@ class NistTest : private StatisticalTest {
         "Serial Test 16",
         "Serial Test 15",
         "Approximate Entropy Test",
-        "Cumulative Sums Test",
+        "Cumulative Sums Test Forward",
+        "Cumulative Sums Test Reverse",
         "Random Excursions Test -4",
         "Random Excursions Test -3",
         "Random Excursions Test -2",
@@ -74,15 +76,34 @@ class NistTest : private StatisticalTest {
         "Random Excursions Variant Test",
     };
 
+    // Template length of the non-overlapping template matching test, all aperiodic templates of it are tested
+    static constexpr size_t template_length = 9;
+
+    // base_test_names with the first non-overlapping template in slot 6 and the other templates after them
+    std::vector<std::string> test_names;
+    std::vector<utils::seq_bytes> templates;
+
     std::vector<size_t> test_success;
     std::vector<std::vector<std::double_t>> save_p_values;
-    std::vector<std::vector<std::string>> test_errors;
+    // Number of the failed sequence and the error message
+    std::vector<std::vector<std::pair<size_t, std::string>>> test_errors;
+
+    // Maximum number of tests of one sequence running concurrently, 0 means no limit
+    size_t threads;
 
   public:
-    NistTest(const double &alpha = 0.01f);
+    // Tests run on utils::ThreadPool::global(). With threads = 1 they run one by one and each of them may still use
+    // the whole pool for its blocks
+    NistTest(const double &alpha = 0.01f, size_t threads = 0);
 
     void test(const utils::seq_bytes &bytes, const bool &print_p_values = false) override;
 
+    // Appends the results of other as if its sequences were tested after the sequences of this test
+    void merge(const NistTest &other);
+
+    // Whether both tests have the same results, the number of threads is not compared
+    bool operator==(const NistTest &other) const;
+
     void print_statistics(const std::string &generator_name) const override;
 };
 
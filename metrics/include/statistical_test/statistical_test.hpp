@@ -16,6 +16,8 @@ class StatisticalTest {
 
     bool compare_p_value(const std::double_t &p_value) const;
 
+    bool operator==(const StatisticalTest &other) const = default;
+
   public:
     StatisticalTest(const double &alpha);
 
@@ -0,0 +1,222 @@
+#include "metrics/berlekamp_massey.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <utility>
+
+#include "metrics/thread_pool.hpp"
+
+namespace {
+
+constexpr size_t word_bits = 64;
+
+// Berlekamp-Massey over GF(2) with polynomials packed into 64-bit words:
+// coefficient j is stored in bit j % 64 of word j / 64.
+class BerlekampMassey {
+    // Block bits in reverse order, so that s_{N - j} is reversed[length - 1 - N + j]
+    std::vector<std::uint64_t> reversed;
+    std::vector<std::uint64_t> C;
+    std::vector<std::uint64_t> B;
+    std::vector<std::uint64_t> T;
+
+    std::uint64_t window(size_t position) const {
+        size_t index = position / word_bits;
+        size_t shift = position % word_bits;
+        if (shift == 0) {
+            return reversed[index];
+        }
+        return (reversed[index] >> shift) | (reversed[index + 1] << (word_bits - shift));
+    }
+
+  public:
+    explicit BerlekampMassey(size_t length)
+        : reversed(length / word_bits + 3), C(reversed.size()), B(reversed.size()), T(reversed.size()) {
+    }
+
+    size_t run(const utils::seq_bytes &bytes, size_t offset, size_t length) {
+        if (length / word_bits + 3 > reversed.size()) {
+            *this = BerlekampMassey(length);
+        }
+        std::fill(reversed.begin(), reversed.end(), 0);
+        std::fill(C.begin(), C.end(), 0);
+        std::fill(B.begin(), B.end(), 0);
+        for (size_t k = 0; k < length; ++k) {
+            if (bytes[offset + length - 1 - k]) {
+                reversed[k / word_bits] |= std::uint64_t(1) << (k % word_bits);
+            }
+        }
+        C[0] = 1;
+        B[0] = 1;
+        size_t L = 0;
+        // Linear complexity at the moment B was saved, deg(B) <= L_B
+        size_t L_B = 0;
+        // Position of the last length change, m = -1 is stored as 0 with shift N + 1
+        size_t m = 0;
+        bool m_initial = true;
+        for (size_t N = 0; N < length; ++N) {
+            // Discrepancy d = sum_{j=0}^{L} C_j * s_{N - j} (mod 2) is the parity of (C & window)
+            size_t start = length - 1 - N;
+            size_t words = L / word_bits + 1;
+            std::uint64_t acc = 0;
+            for (size_t w = 0; w < words; ++w) {
+                acc ^= C[w] & window(start + w * word_bits);
+            }
+            if ((std::popcount(acc) & 1) == 0) {
+                continue;
+            }
+            bool grow = 2 * L <= N;
+            if (grow) {
+                std::copy(C.begin(), C.begin() + words, T.begin());
+            }
+            // C ^= B << (N - m)
+            size_t shift = m_initial ? N + 1 : N - m;
+            size_t word_shift = shift / word_bits;
+            size_t bit_shift = shift % word_bits;
+            size_t words_B = L_B / word_bits + 1;
+            for (size_t w = 0; w < words_B; ++w) {
+                C[w + word_shift] ^= B[w] << bit_shift;
+                if (bit_shift != 0) {
+                    C[w + word_shift + 1] ^= B[w] >> (word_bits - bit_shift);
+                }
+            }
+            if (grow) {
+                L_B = L;
+                L = N + 1 - L;
+                m = N;
+                m_initial = false;
+                std::swap(B, T);
+            }
+        }
+        return L;
+    }
+};
+
+// Bit-sliced Berlekamp-Massey: every coefficient is a group of Words 64-bit words, bit b of word w belongs to block
+// 64 * w + b. Instead of B the class keeps D = x^{N - m} * B, so the update C ^= B << (N - m) is the same for all
+// blocks, and D itself is shifted by one on every step.
+template <size_t Words>
+class BitSlicedBerlekampMassey {
+    static constexpr size_t lanes = Words * word_bits;
+
+    // Transposed input: S[k * Words + w] holds bit k of blocks 64 * w ... 64 * w + 63
+    std::vector<std::uint64_t> S;
+    std::vector<std::uint64_t> C;
+    std::vector<std::uint64_t> D;
+    std::vector<std::uint32_t> L;
+
+  public:
+    explicit BitSlicedBerlekampMassey(size_t length)
+        : S(length * Words), C((length + 2) * Words), D((length + 2) * Words), L(lanes) {
+    }
+
+    // Computes linear complexity of count <= lanes blocks starting from block first
+    void run(const utils::seq_bytes &bytes, size_t length, size_t first, size_t count, size_t *complexity) {
+        std::fill(S.begin(), S.end(), 0);
+        std::fill(C.begin(), C.end(), 0);
+        std::fill(D.begin(), D.end(), 0);
+        std::fill(L.begin(), L.end(), 0);
+        for (size_t lane = 0; lane < count; ++lane) {
+            const unsigned char *block = bytes.data() + (first + lane) * length;
+            std::uint64_t bit = std::uint64_t(1) << (lane % word_bits);
+            size_t w = lane / word_bits;
+            for (size_t k = 0; k < length; ++k) {
+                if (block[k]) {
+                    S[k * Words + w] |= bit;
+                }
+            }
+        }
+        for (size_t w = 0; w < Words; ++w) {
+            C[w] = ~std::uint64_t(0);
+            // B = 1 and m = -1, so D = x * B
+            D[Words + w] = ~std::uint64_t(0);
+        }
+        std::uint64_t d[Words];
+        std::uint64_t grow[Words];
+        // deg(C) <= L in every block, so coefficients above the largest L are zero
+        std::uint32_t max_L = 0;
+        for (size_t N = 0; N < length; ++N) {
+            for (size_t w = 0; w < Words; ++w) {
+                d[w] = 0;
+            }
+            for (size_t j = 0; j <= max_L; ++j) {
+                const std::uint64_t *c = &C[j * Words];
+                const std::uint64_t *s = &S[(N - j) * Words];
+                for (size_t w = 0; w < Words; ++w) {
+                    d[w] ^= c[w] & s[w];
+                }
+            }
+            for (size_t w = 0; w < Words; ++w) {
+                std::uint64_t mask = 0;
+                for (size_t b = 0; b < word_bits; ++b) {
+                    std::uint32_t &l = L[w * word_bits + b];
+                    std::uint64_t g = ((d[w] >> b) & 1) & static_cast<std::uint64_t>(2 * l <= N);
+                    l = g ? static_cast<std::uint32_t>(N + 1) - l : l;
+                    mask |= g << b;
+                    max_L = std::max(max_L, l);
+                }
+                grow[w] = mask;
+            }
+            // C ^= d & D, D = x * (grow ? C : D); the degree of both is at most N + 1
+            for (size_t j = N + 2; j-- > 0;) {
+                std::uint64_t *c = &C[j * Words];
+                std::uint64_t *dj = &D[j * Words];
+                std::uint64_t *next = &D[(j + 1) * Words];
+                for (size_t w = 0; w < Words; ++w) {
+                    std::uint64_t old_c = c[w];
+                    std::uint64_t old_d = dj[w];
+                    c[w] = old_c ^ (d[w] & old_d);
+                    next[w] = (grow[w] & old_c) | (~grow[w] & old_d);
+                }
+            }
+            for (size_t w = 0; w < Words; ++w) {
+                D[w] = 0;
+            }
+        }
+        for (size_t lane = 0; lane < count; ++lane) {
+            complexity[lane] = L[lane];
+        }
+    }
+};
+
+#ifdef __AVX512F__
+constexpr size_t bitsliced_words = 8;
+#else
+constexpr size_t bitsliced_words = 1;
+#endif
+
+} // namespace
+
+namespace utils {
+
+size_t berlekamp_massey(const seq_bytes &bytes, size_t offset, size_t length) {
+    BerlekampMassey engine(length);
+    return engine.run(bytes, offset, length);
+}
+
+std::vector<size_t> berlekamp_massey_blocks(const seq_bytes &bytes, size_t M, size_t N) {
+    std::vector<size_t> complexity(N);
+    parallel_for(N, [&](size_t first, size_t last) {
+        BerlekampMassey engine(M);
+        for (size_t i = first; i < last; ++i) {
+            complexity[i] = engine.run(bytes, i * M, M);
+        }
+    });
+    return complexity;
+}
+
+std::vector<size_t> berlekamp_massey_blocks_bitsliced(const seq_bytes &bytes, size_t M, size_t N) {
+    using Engine = BitSlicedBerlekampMassey<bitsliced_words>;
+    constexpr size_t lanes = bitsliced_words * word_bits;
+    std::vector<size_t> complexity(N);
+    size_t groups = (N + lanes - 1) / lanes;
+    parallel_for(groups, [&](size_t first_group, size_t last_group) {
+        Engine engine(M);
+        for (size_t g = first_group; g < last_group; ++g) {
+            size_t first = g * lanes;
+            engine.run(bytes, M, first, std::min(lanes, N - first), complexity.data() + first);
+        }
+    });
+    return complexity;
+}
+
+} // namespace utils
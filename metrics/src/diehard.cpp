@@ -1,5 +1,7 @@
 #include "statistical_test/diehard.hpp"
 
+#include <stdexcept>
+
 namespace statistical_test {
 
 DiehardTest::DiehardTest(const double &alpha) : StatisticalTest(alpha) {
@@ -7,6 +9,9 @@ DiehardTest::DiehardTest(const double &alpha) : StatisticalTest(alpha) {
 }
 
 void DiehardTest::test(const utils::seq_bytes &bytes, const bool &print_p_values) {
+    if (bytes.size() < min_bits) {
+        throw std::runtime_error("DIEHARD TEST: SEQUENCE IS TOO SHORT");
+    }
     test_count++;
     {
         std::double_t p_value = diehard::runs_test(bytes);
@@ -25,7 +30,7 @@ void DiehardTest::test(const utils::seq_bytes &bytes, const bool &print_p_values
     }
 
     {
-        std::double_t p_value = diehard::birthdays_test(bytes, 24, 52, 100);
+        std::double_t p_value = diehard::birthdays_test(bytes, 24, 512, 100);
         if (print_p_values) {
             std::cout << test_names[2] << ": " << p_value << std::endl;
         }
@@ -43,7 +48,7 @@ void DiehardTest::test(const utils::seq_bytes &bytes, const bool &print_p_values
     {
         std::double_t p_value = diehard::minimum_distance_test(bytes, 3, 400, 10);
         if (print_p_values) {
-            std::cout << test_names[3] << ": " << p_value << std::endl;
+            std::cout << test_names[4] << ": " << p_value << std::endl;
         }
         test_success[4] += compare_p_value(p_value);
     }
@@ -51,7 +56,7 @@ void DiehardTest::test(const utils::seq_bytes &bytes, const bool &print_p_values
     {
         std::double_t p_value = diehard::overlapping_permutations_test(bytes, 1000);
         if (print_p_values) {
-            std::cout << test_names[4] << ": " << p_value << std::endl;
+            std::cout << test_names[5] << ": " << p_value << std::endl;
         }
         test_success[5] += compare_p_value(p_value);
     }
@@ -59,7 +64,7 @@ void DiehardTest::test(const utils::seq_bytes &bytes, const bool &print_p_values
     {
         std::double_t p_value = diehard::monkey_test(bytes, 256000);
         if (print_p_values) {
-            std::cout << test_names[5] << ": " << p_value << std::endl;
+            std::cout << test_names[6] << ": " << p_value << std::endl;
         }
         test_success[6] += compare_p_value(p_value);
     }
@@ -67,7 +72,7 @@ void DiehardTest::test(const utils::seq_bytes &bytes, const bool &print_p_values
     {
         std::double_t p_value = diehard::squeeze_test(bytes, 200);
         if (print_p_values) {
-            std::cout << test_names[6] << ": " << p_value << std::endl;
+            std::cout << test_names[7] << ": " << p_value << std::endl;
         }
         test_success[7] += compare_p_value(p_value);
     }
@@ -75,7 +80,7 @@ void DiehardTest::test(const utils::seq_bytes &bytes, const bool &print_p_values
     {
         std::double_t p_value = diehard::sums_test(bytes, 10000);
         if (print_p_values) {
-            std::cout << test_names[7] << ": " << p_value << std::endl;
+            std::cout << test_names[8] << ": " << p_value << std::endl;
         }
         test_success[8] += compare_p_value(p_value);
     }
@@ -83,16 +88,86 @@ void DiehardTest::test(const utils::seq_bytes &bytes, const bool &print_p_values
     {
         std::double_t p_value = diehard::craps_test(bytes, 2000);
         if (print_p_values) {
-            std::cout << test_names[8] << ": " << p_value << std::endl;
+            std::cout << test_names[9] << ": " << p_value << std::endl;
         }
         test_success[9] += compare_p_value(p_value);
     }
+
+    {
+        std::double_t p_value = diehard::opso_test(bytes, 1);
+        if (print_p_values) {
+            std::cout << test_names[10] << ": " << p_value << std::endl;
+        }
+        test_success[10] += compare_p_value(p_value);
+    }
+
+    {
+        std::double_t p_value = diehard::oqso_test(bytes, 1);
+        if (print_p_values) {
+            std::cout << test_names[11] << ": " << p_value << std::endl;
+        }
+        test_success[11] += compare_p_value(p_value);
+    }
+
+    {
+        std::double_t p_value = diehard::dna_test(bytes, 1);
+        if (print_p_values) {
+            std::cout << test_names[12] << ": " << p_value << std::endl;
+        }
+        test_success[12] += compare_p_value(p_value);
+    }
+
+    {
+        std::double_t p_value = diehard::parking_lot_test(bytes, 10);
+        if (print_p_values) {
+            std::cout << test_names[13] << ": " << p_value << std::endl;
+        }
+        test_success[13] += compare_p_value(p_value);
+    }
+
+    {
+        std::double_t p_value = diehard::spheres_3d_test(bytes, 20);
+        if (print_p_values) {
+            std::cout << test_names[14] << ": " << p_value << std::endl;
+        }
+        test_success[14] += compare_p_value(p_value);
+    }
+
+    {
+        std::double_t p_value = diehard::count_ones_stream_test(bytes, 256000);
+        if (print_p_values) {
+            std::cout << test_names[15] << ": " << p_value << std::endl;
+        }
+        test_success[15] += compare_p_value(p_value);
+    }
+
+    {
+        std::double_t p_value = diehard::count_ones_bytes_test(bytes, 256000);
+        if (print_p_values) {
+            std::cout << test_names[16] << ": " << p_value << std::endl;
+        }
+        test_success[16] += compare_p_value(p_value);
+    }
+}
+
+void DiehardTest::merge(const DiehardTest &other) {
+    if (other.alpha != alpha) {
+        throw std::invalid_argument("Merged Diehard tests must have the same alpha");
+    }
+    for (size_t i = 0; i < test_success.size(); ++i) {
+        test_success[i] += other.test_success[i];
+    }
+    test_count += other.test_count;
+}
+
+bool DiehardTest::operator==(const DiehardTest &other) const {
+    return StatisticalTest::operator==(other) && test_success == other.test_success;
 }
 
 void DiehardTest::print_statistics(const std::string &generator_name) const {
     std::cout << "Diehard test for " << generator_name << std::endl;
     size_t pass_count = 0;
-    for (size_t i = 0; i < 10; ++i) {
+    for (size_t i = 0; i < test_names.size(); ++i) {
         bool answer = static_cast<std::double_t>(test_success[i]) / static_cast<std::double_t>(test_count) >= 0.95;
         std::cout << test_names[i] << ": " << result_to_string(answer) << " (" << test_success[i] << " / " << test_count
                   << ")" << std::endl;
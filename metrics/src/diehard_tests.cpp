@@ -1,18 +1,24 @@
 #include <algorithm>
-#include <bitset>
+#include <array>
+#include <bit>
 #include <boost/math/distributions/chi_squared.hpp>
 #include <boost/math/distributions/normal.hpp>
 #include <cmath>
+#include <cstring>
 #include <iostream>
 #include <map>
+#include <mutex>
 #include <numeric>
-#include <unordered_map>
+#include <stdexcept>
+#include <string>
 #include <utility>
 
 #include "diehard_const.hpp"
 #include "diehard_tests.hpp"
 #include "metrics/binary_matrix.hpp"
 #include "metrics/diehard_tests.hpp"
+#include "metrics/point_grid.hpp"
+#include "metrics/thread_pool.hpp"
 #include "metrics/utils.hpp"
 
 double diehard::runs_test(const utils::seq_bytes &bytes) {
@@ -97,69 +103,240 @@ double diehard::matrix_test(const utils::seq_bytes &bytes, int rows, int cols, i
     return p_value;
 }
 
+namespace {
+
+// LSD radix sort of values below 2^bits by bytes, buffer is scratch space of the same size
+void radix_sort(std::vector<std::uint64_t> &values, std::vector<std::uint64_t> &buffer, int bits) {
+    constexpr int digit_bits = 8;
+    constexpr size_t buckets = size_t(1) << digit_bits;
+    buffer.resize(values.size());
+    for (int shift = 0; shift < bits; shift += digit_bits) {
+        size_t offsets[buckets] = {};
+        for (std::uint64_t value : values) {
+            offsets[(value >> shift) & (buckets - 1)]++;
+        }
+        size_t total = 0;
+        for (size_t &offset : offsets) {
+            size_t count = offset;
+            offset = total;
+            total += count;
+        }
+        for (std::uint64_t value : values) {
+            buffer[offsets[(value >> shift) & (buckets - 1)]++] = value;
+        }
+        values.swap(buffer);
+    }
+}
+
+// Probabilities of the letters A ... E
+constexpr std::array<double, 5> letter_probabilities = {37.0 / 256, 56.0 / 256, 70.0 / 256, 56.0 / 256, 37.0 / 256};
+
+// Letter of the byte made of the 8 bits starting at bits: A for at most 2 ones, B, C, D for 3, 4, 5 ones and E for at
+// least 6 ones. The bits are bytes holding 0 or 1, so the multiplication sums them into the highest byte. Both steps
+// are branch-free and vectorize over a block of letters
+inline std::uint8_t letter_of_byte(const std::uint8_t *bits) {
+    std::uint64_t group;
+    std::memcpy(&group, bits, sizeof(group));
+    const int ones = static_cast<int>((group * 0x0101010101010101) >> 56);
+    return static_cast<std::uint8_t>(std::clamp(ones, 2, 6) - 2);
+}
+
+// Counts of the 5-letter (first) and 4-letter (second) words starting at letters 0 ... num_words - 1, letter(p)
+// returns the letter p. Chunks of words are counted in parallel, blocks of a chunk first compute their letters and
+// the base-5 codes of their words, then count the codes. A 4-letter word is the prefix of the 5-letter word at the
+// same letter, so its counts are sums of the 5-letter counts
+template <typename Letter>
+std::pair<std::vector<size_t>, std::vector<size_t>> count_base_5_words(size_t num_words, const Letter &letter) {
+    constexpr size_t block = 4096;
+    std::vector<size_t> counts_5(3125, 0);
+    std::mutex counts_mutex;
+    utils::parallel_for(
+        num_words,
+        [&](size_t first, size_t last) {
+            std::vector<size_t> local(3125, 0);
+            std::array<std::uint8_t, block + 4> letters;
+            std::array<std::uint16_t, block> codes;
+            for (size_t start = first; start < last; start += block) {
+                const size_t count = std::min(block, last - start);
+                for (size_t i = 0; i < count + 4; ++i) {
+                    letters[i] = letter(start + i);
+                }
+                for (size_t i = 0; i < count; ++i) {
+                    codes[i] = static_cast<std::uint16_t>(letters[i] * 625 + letters[i + 1] * 125 +
+                                                          letters[i + 2] * 25 + letters[i + 3] * 5 + letters[i + 4]);
+                }
+                for (size_t i = 0; i < count; ++i) {
+                    local[codes[i]]++;
+                }
+            }
+            std::lock_guard<std::mutex> lock(counts_mutex);
+            for (size_t w = 0; w < 3125; ++w) {
+                counts_5[w] += local[w];
+            }
+        },
+        1 << 16);
+    std::vector<size_t> counts_4(625, 0);
+    for (size_t w = 0; w < 3125; ++w) {
+        counts_4[w / 5] += counts_5[w];
+    }
+    return {counts_5, counts_4};
+}
+
+// Chi-square of the counts of all base-5 words of a length, word w has the letters of its base-5 digits
+double word_counts_chi_sq(const std::vector<size_t> &counts, int num_samples) {
+    std::vector<double> observed(counts.size());
+    std::vector<double> expected(counts.size());
+    for (size_t word = 0; word < counts.size(); ++word) {
+        observed[word] = static_cast<double>(counts[word]);
+        double expected_count = num_samples;
+        for (size_t rest = word, length = 1; length < counts.size(); rest /= 5, length *= 5) {
+            expected_count *= letter_probabilities[rest % 5];
+        }
+        expected[word] = expected_count;
+    }
+    return utils::chi_square(observed, expected, static_cast<int>(counts.size()));
+}
+
+// Sparse occupancy test of 2^21 overlapping 20-bit words per repetition. Repetition r starts at bit
+// r * (2^21 + letters per word - 1) * letter_bits, its words start every letter_bits bits
+double sparse_occupancy_test(const utils::seq_bytes &bytes, const char *name, size_t letter_bits, double sigma,
+                             int num_repetitions) {
+    constexpr size_t word_bits = 20;
+    constexpr size_t num_words = size_t(1) << 21;
+    // Expected number of missing words, 2^20 * e^-2
+    constexpr double mean = 141909;
+    if (num_repetitions < 1) {
+        throw std::runtime_error(std::string(name) + " TEST: TOO FEW REPETITIONS");
+    }
+    const size_t repetition_bits = (num_words + word_bits / letter_bits - 1) * letter_bits;
+    const size_t needed_bits = repetition_bits * num_repetitions;
+    if (bytes.size() < needed_bits) {
+        throw std::runtime_error(std::string(name) + " TEST: SEQUENCE IS TOO SHORT");
+    }
+
+    const std::vector<std::uint64_t> words = utils::pack_bits(bytes, needed_bits);
+    std::vector<double> p_values(num_repetitions);
+    utils::parallel_for(num_repetitions, [&](size_t first, size_t last) {
+        // One bit per possible word, 128 KB stay in L2
+        std::vector<std::uint64_t> occupied((size_t(1) << word_bits) / 64);
+        for (size_t repetition = first; repetition < last; ++repetition) {
+            std::fill(occupied.begin(), occupied.end(), 0);
+            const size_t start = repetition * repetition_bits;
+            for (size_t i = 0; i < num_words; ++i) {
+                const std::uint64_t word = utils::packed_window(words, start + i * letter_bits, word_bits);
+                occupied[word / 64] |= std::uint64_t(1) << (word % 64);
+            }
+            size_t present = 0;
+            for (std::uint64_t bits : occupied) {
+                present += std::popcount(bits);
+            }
+            const double missing = static_cast<double>((size_t(1) << word_bits) - present);
+            // Two-sided, too many and too few missing words both fail
+            p_values[repetition] = std::erfc(std::abs(missing - mean) / sigma / std::sqrt(2.0));
+        }
+    });
+    return utils::kstest(p_values);
+}
+
+// Q5 - Q4 of the chi-squares of the 5-letter and 4-letter words is normal with mean 5^5 - 5^4 and deviation
+// sqrt(2 * 2500)
+constexpr double word_counts_mean = 2500, word_counts_sigma = 70.7106781;
+
+double word_counts_statistic(const std::pair<std::vector<size_t>, std::vector<size_t>> &counts, int num_words) {
+    return word_counts_chi_sq(counts.first, num_words) - word_counts_chi_sq(counts.second, num_words);
+}
+
+// Two-sided p-value of the Q5 - Q4 statistic
+double word_counts_p_value(const std::pair<std::vector<size_t>, std::vector<size_t>> &counts, int num_words) {
+    const double statistic = word_counts_statistic(counts, num_words);
+    return std::erfc(std::abs(statistic - word_counts_mean) / word_counts_sigma / std::sqrt(2.0));
+}
+
+} // namespace
+
+// Counts of the 5-letter (first) and 4-letter (second) words starting at bits 0 ... num_samples, letter p is made
+// from the byte at bits p ... p + 7. Both are counted in one pass over the letters
+std::pair<std::vector<size_t>, std::vector<size_t>> diehard::base_5_word_counts(const utils::seq_bytes &bytes,
+                                                                                int num_samples) {
+    if (num_samples < 1) {
+        throw std::runtime_error("MONKEY TEST: TOO FEW SAMPLES");
+    }
+    if (bytes.size() < static_cast<size_t>(num_samples) + 12) {
+        throw std::runtime_error("MONKEY TEST: SEQUENCE IS TOO SHORT");
+    }
+    return count_base_5_words(num_samples + 1, [&bytes](size_t p) { return letter_of_byte(bytes.data() + p); });
+}
+
 double diehard::birthdays_test(const utils::seq_bytes &bytes, int days_bits, int num_bdays, int tsamples) {
-    // days_bits should be <= 32
-    // bytes length should be >= days_bits * num_bdays + tsamples
+    // Sample s takes num_bdays birthdays of days_bits bits each, starting from bit s * num_bdays * days_bits
+    if (days_bits < 1 || days_bits > 64) {
+        throw std::runtime_error("BIRTHDAYS TEST: DAYS BITS IS OUT OF RANGE");
+    }
+    if (num_bdays < 2 || tsamples < 1) {
+        throw std::runtime_error("BIRTHDAYS TEST: TOO FEW BIRTHDAYS OR SAMPLES");
+    }
+    const size_t sample_bits = static_cast<size_t>(num_bdays) * days_bits;
+    const size_t needed_bits = static_cast<size_t>(tsamples) * sample_bits;
+    if (bytes.size() < needed_bits) {
+        throw std::runtime_error("BIRTHDAYS TEST: SEQUENCE IS TOO SHORT");
+    }
 
-    static double lambda = (double)num_bdays * num_bdays * num_bdays / std::pow(2.0, (double)days_bits + 2.0);
+    // If num_bdays = 512 and days_bits = 24, lambda = 2
+    // If num_bdays = 2048 and days_bits = 30, lambda = 2
+    // If num_bdays = 2^14 and days_bits = 40, lambda = 1
+    const double lambda = std::pow(static_cast<double>(num_bdays), 3) / std::pow(2.0, days_bits + 2.0);
     int kmax = 1;
     while ((tsamples * utils::poissonian(kmax, lambda)) > 5) {
         kmax++;
     }
     kmax++;
 
-    std::vector<double> histogram(kmax, 0.0);
-
-    for (size_t sample = 0; sample < tsamples; sample++) {
-        std::vector<unsigned int> uints;
-        for (size_t i = 0; i < num_bdays; i++) {
-            std::vector<bool> sub_vec(bytes.begin() + i * days_bits + sample,
-                                      bytes.begin() + i * days_bits + sample + days_bits);
-            std::bitset<32> bday_bitset(0);
-            for (size_t j = 0; j < days_bits; j++) {
-                bday_bitset[days_bits - 1 - j] = sub_vec[j];
+    const std::vector<std::uint64_t> words = utils::pack_bits(bytes, needed_bits);
+    std::vector<size_t> counts(kmax, 0);
+    std::mutex counts_mutex;
+    utils::parallel_for(tsamples, [&](size_t first, size_t last) {
+        std::vector<size_t> local(kmax, 0);
+        std::vector<std::uint64_t> days(num_bdays);
+        std::vector<std::uint64_t> buffer;
+        for (size_t sample = first; sample < last; ++sample) {
+            for (size_t i = 0; i < static_cast<size_t>(num_bdays); ++i) {
+                days[i] = utils::packed_window(words, sample * sample_bits + i * days_bits, days_bits);
             }
-            uints.push_back(bday_bitset.to_ulong());
-        }
-
-        std::sort(uints.begin(), uints.end());
-
-        // If num_bdays = 512 and days_bits = 24, lambda = 2
-        // If num_bdays = 2048 and days_bits = 30, lambda = 2
+            radix_sort(days, buffer, days_bits);
+            // The first spacing is the first birthday itself, the spacings are sorted in place
+            for (size_t i = num_bdays - 1; i > 0; --i) {
+                days[i] -= days[i - 1];
+            }
+            radix_sort(days, buffer, days_bits);
 
-        std::vector<unsigned int> intervals(num_bdays);
-        intervals[0] = uints[0];
-        for (size_t i = 1; i < num_bdays; i++) {
-            intervals[i] = uints[i] - uints[i - 1];
-        }
-        std::sort(intervals.begin(), intervals.end());
-
-        // Count how many intervals occur more than once
-        int k = 0;
-        for (int i_interval = 1; i_interval < num_bdays; ++i_interval) {
-            if (intervals[i_interval] == intervals[i_interval - 1]) {
-                ++k;
-                while (i_interval < intervals.size() && intervals[i_interval] == intervals[i_interval - 1]) {
-                    i_interval++;
+            // Count how many spacing values occur more than once
+            int k = 0;
+            for (size_t i = 1; i < days.size(); ++i) {
+                if (days[i] == days[i - 1] && (i == 1 || days[i - 1] != days[i - 2])) {
+                    ++k;
                 }
             }
+            local[std::min(k, kmax - 1)]++;
         }
-
-        if (k < kmax) {
-            histogram[k] += 1.0;
-        } else {
-            histogram[k] += 1.0;
+        std::lock_guard<std::mutex> lock(counts_mutex);
+        for (int k = 0; k < kmax; ++k) {
+            counts[k] += local[k];
         }
-    }
+    });
 
+    std::vector<double> histogram(counts.begin(), counts.end());
     std::vector<double> expected_histogram(kmax, 0);
-    for (size_t k = 0; k < kmax; k++) {
+    // The last bin counts kmax - 1 or more repeats, so it expects the whole tail
+    double tail = 1.0;
+    for (int k = 0; k < kmax - 1; k++) {
         expected_histogram[k] = tsamples * utils::poissonian(k, lambda);
+        tail -= utils::poissonian(k, lambda);
     }
+    expected_histogram[kmax - 1] = tsamples * tail;
 
     // Calculate chi_square and p-value
     double chi_square = utils::chi_square(histogram, expected_histogram, kmax);
-    double p_value = utils::p_value((double)(kmax - 1) / 2.0, chi_square / 2.0);
+    double p_value = utils::p_value(kmax - 1, chi_square);
 
     return p_value;
 }
@@ -167,77 +344,171 @@ double diehard::birthdays_test(const utils::seq_bytes &bytes, int days_bits, int
 double diehard::minimum_distance_test(const utils::seq_bytes &bytes, int n_dims, int num_coordinates, int num_samples) {
     const double pi = boost::math::constants::pi<double>();
     static double rgb_md_Q[] = {0.0, 0.0, 0.4135, 0.5312, 0.6202, 1.3789};
-    std::vector<double> p_values;
-    for (size_t sample = 0; sample < num_samples; sample++) {
-        // Create num_coordinates dots in n_dims dimentional space
-        std::vector<std::vector<double>> coordinates;
-        auto start = bytes.begin() + sample * num_coordinates;
-        auto end = bytes.begin() + (sample + 1) * num_coordinates;
-        utils::seq_bytes sub_seq_bytes(start, end);
-        // std::vector<double> doubles = utils::doubles_from_bits(sub_seq_bytes, num_coordinates * n_dims);
-        std::vector<double> doubles = utils::random_doubles(num_coordinates * n_dims);
-        for (size_t dot_num = 0; dot_num < num_coordinates; dot_num++) {
-            std::vector<double> dot;
-            for (size_t dim = 0; dim < n_dims; dim++) {
-                dot.push_back(doubles[dot_num * n_dims + dim]);
-            }
-            coordinates.push_back(dot);
-        }
-        // Sort the dots by their first coordinate
-        std::sort(coordinates.begin(), coordinates.end(),
-                  [](const std::vector<double> &a, const std::vector<double> &b) { return a[0] < b[0]; });
-        // Go through the coordinates and find the minimum distance between dots
-        double minimal_distance = std::numeric_limits<double>::max();
-        for (size_t i = 1; i < coordinates.size(); i++) {
-            double distance = 0;
-            for (size_t dim = 0; dim < n_dims; dim++) {
-                distance += std::pow(coordinates[i][dim] - coordinates[i - 1][dim], 2);
+    if (n_dims != 2 && n_dims != 3) {
+        throw std::runtime_error("MINIMUM DISTANCE TEST: ONLY 2 AND 3 DIMENSIONS ARE SUPPORTED");
+    }
+    // Every coordinate is a double made of 64 bits of the sequence, sample after sample
+    const size_t count_doubles = static_cast<size_t>(num_samples) * num_coordinates * n_dims;
+    if (num_coordinates < 2 || bytes.size() < count_doubles * 64) {
+        throw std::runtime_error("MINIMUM DISTANCE TEST: SEQUENCE IS TOO SHORT");
+    }
+    const std::vector<double> doubles = utils::bits_to_doubles(bytes, static_cast<int>(count_doubles));
+    std::vector<double> p_values(num_samples);
+    utils::parallel_for(num_samples, [&](size_t first, size_t last) {
+        for (size_t sample = first; sample < last; sample++) {
+            // Dots of the unit cube in n_dims dimensions
+            const double *dots = doubles.data() + sample * num_coordinates * n_dims;
+            double minimal_distance = 0;
+            if (n_dims == 2) {
+                std::vector<std::array<double, 2>> points(num_coordinates);
+                for (size_t i = 0; i < points.size(); ++i) {
+                    points[i] = {dots[2 * i], dots[2 * i + 1]};
+                }
+                minimal_distance = std::sqrt(utils::closest_pair_squared(points, 1.0));
+            } else {
+                std::vector<std::array<double, 3>> points(num_coordinates);
+                for (size_t i = 0; i < points.size(); ++i) {
+                    points[i] = {dots[3 * i], dots[3 * i + 1], dots[3 * i + 2]};
+                }
+                minimal_distance = std::sqrt(utils::closest_pair_squared(points, 1.0));
             }
-            distance = std::sqrt(distance);
-            if (distance < minimal_distance) {
-                minimal_distance = distance;
+
+            double dvolume;
+            if ((n_dims % 2) == 0) {
+                dvolume = std::pow(pi, n_dims / 2) * std::pow(minimal_distance, n_dims) /
+                          boost::math::factorial<double>(n_dims / 2);
+            } else {
+                dvolume = 2.0 * std::pow(2.0 * pi, (n_dims - 1) / 2) * std::pow(minimal_distance, n_dims) /
+                          boost::math::double_factorial<double>(n_dims);
             }
+            double earg = -1.0 * num_coordinates * (num_coordinates - 1) * dvolume / 2.0;
+            double qarg =
+                1.0 + ((2.0 + rgb_md_Q[n_dims]) / 6.0) * std::pow(1.0 * num_coordinates, 3) * dvolume * dvolume;
+            p_values[sample] = 1.0 - std::exp(earg) * qarg;
         }
+    });
+    return utils::kstest(p_values);
+}
 
-        double dvolume;
-        if ((n_dims % 2) == 0) {
-            dvolume = std::pow(pi, n_dims / 2) * std::pow(minimal_distance, n_dims) /
-                      boost::math::factorial<double>(n_dims / 2);
-        } else {
-            dvolume = 2.0 * std::pow(2.0 * pi, (n_dims - 1) / 2) * std::pow(minimal_distance, n_dims) /
-                      boost::math::double_factorial<double>(n_dims);
+double diehard::parking_lot_test(const utils::seq_bytes &bytes, int num_samples) {
+    constexpr size_t num_tries = 12000;
+    constexpr double side = 100;
+    constexpr double mean = 3523, sigma = 21.9;
+    // Every try takes two doubles of 64 bits of the sequence, sample after sample
+    if (num_samples < 1) {
+        throw std::runtime_error("PARKING LOT TEST: TOO FEW SAMPLES");
+    }
+    const size_t count_doubles = static_cast<size_t>(num_samples) * num_tries * 2;
+    if (bytes.size() < count_doubles * 64) {
+        throw std::runtime_error("PARKING LOT TEST: SEQUENCE IS TOO SHORT");
+    }
+    const std::vector<double> doubles = utils::bits_to_doubles(bytes, static_cast<int>(count_doubles));
+    std::vector<double> p_values(num_samples);
+    utils::parallel_for(num_samples, [&](size_t first, size_t last) {
+        for (size_t sample = first; sample < last; ++sample) {
+            const double *tries = doubles.data() + sample * num_tries * 2;
+            // Cells of width 1 hold every car a try can crash into in the same or adjacent cells
+            utils::IncrementalPointGrid<2> lot(side, static_cast<size_t>(side));
+            for (size_t i = 0; i < num_tries; ++i) {
+                const std::array<double, 2> car = {side * tries[2 * i], side * tries[2 * i + 1]};
+                if (!lot.has_point_within(car, 1.0, utils::Norm::maximum)) {
+                    lot.insert(car);
+                }
+            }
+            boost::math::normal_distribution<double> normal_dist(mean, sigma);
+            p_values[sample] = boost::math::cdf(normal_dist, static_cast<double>(lot.size()));
         }
-        double earg = -1.0 * num_coordinates * (num_coordinates - 1) * dvolume / 2.0;
-        double qarg = 1.0 + ((2.0 + rgb_md_Q[n_dims]) / 6.0) * std::pow(1.0 * num_coordinates, 3) * dvolume * dvolume;
-        double p_value = 1.0 - std::exp(earg) * qarg;
+    });
+    return utils::kstest(p_values);
+}
 
-        p_values.push_back(p_value);
+double diehard::spheres_3d_test(const utils::seq_bytes &bytes, int num_samples) {
+    constexpr size_t num_points = 4000;
+    constexpr double side = 1000;
+    if (num_samples < 1) {
+        throw std::runtime_error("3D SPHERES TEST: TOO FEW SAMPLES");
     }
+    const size_t count_doubles = static_cast<size_t>(num_samples) * num_points * 3;
+    if (bytes.size() < count_doubles * 64) {
+        throw std::runtime_error("3D SPHERES TEST: SEQUENCE IS TOO SHORT");
+    }
+    const std::vector<double> doubles = utils::bits_to_doubles(bytes, static_cast<int>(count_doubles));
+    std::vector<double> p_values(num_samples);
+    utils::parallel_for(num_samples, [&](size_t first, size_t last) {
+        for (size_t sample = first; sample < last; ++sample) {
+            const double *coordinates = doubles.data() + sample * num_points * 3;
+            std::vector<std::array<double, 3>> points(num_points);
+            for (size_t i = 0; i < num_points; ++i) {
+                points[i] = {side * coordinates[3 * i], side * coordinates[3 * i + 1], side * coordinates[3 * i + 2]};
+            }
+            const double r_cubed = std::pow(utils::closest_pair_squared(points, side), 1.5);
+            p_values[sample] = 1.0 - std::exp(-r_cubed / 30.0);
+        }
+    });
     return utils::kstest(p_values);
 }
 
 double diehard::overlapping_permutations_test(const utils::seq_bytes &bytes, int num_samples) {
-    std::vector<uint> data = utils::bits_to_vector_uint<uint>(bytes, num_samples + 4);
-    double count[120];
-    double x[120];
-    std::fill(count, count + 120, 0.0);
-    for (size_t sample = 0; sample < num_samples; sample++) {
-        std::vector<int> sub_data(data.begin() + sample, data.begin() + sample + 5);
-        int perm_ind = utils::kperm(sub_data);
-
-        count[perm_ind]++;
+    // Sample s is the ordering of the 32-bit integers s ... s + 4
+    if (num_samples < 1) {
+        throw std::runtime_error("OVERLAPPING PERMUTATIONS TEST: TOO FEW SAMPLES");
     }
-    double chi_square = 0.0;
+    if (bytes.size() < (static_cast<size_t>(num_samples) + 4) * 32) {
+        throw std::runtime_error("OVERLAPPING PERMUTATIONS TEST: SEQUENCE IS TOO SHORT");
+    }
+    std::array<size_t, 120> counts{};
+    std::mutex counts_mutex;
+    utils::parallel_for(
+        num_samples,
+        [&](size_t first, size_t last) {
+            std::array<size_t, 120> local{};
+            // Sliding window of the five integers, every sample reads one new integer
+            std::array<int, 5> window;
+            for (size_t i = 0; i < 4; ++i) {
+                window[i + 1] = static_cast<int>(utils::bits_to_uint<uint>(bytes, 32 * (first + i)));
+            }
+            for (size_t sample = first; sample < last; ++sample) {
+                for (size_t i = 0; i < 4; ++i) {
+                    window[i] = window[i + 1];
+                }
+                window[4] = static_cast<int>(utils::bits_to_uint<uint>(bytes, 32 * (sample + 4)));
+                local[utils::kperm(window)]++;
+            }
+            std::lock_guard<std::mutex> lock(counts_mutex);
+            for (size_t i = 0; i < 120; ++i) {
+                counts[i] += local[i];
+            }
+        },
+        1 << 12);
+
+    // The pseudo-inverse is symmetric, so y = A x is accumulated from its contiguous rows as y += x[j] * A[j],
+    // a loop without a reduction that the compiler vectorizes
+    static const std::vector<double> matrix = [] {
+        std::vector<double> result(120 * 120);
+        for (size_t i = 0; i < 120; ++i) {
+            for (size_t j = 0; j < 120; ++j) {
+                result[i * 120 + j] = static_cast<double>(pseudoInv[i][j]);
+            }
+        }
+        return result;
+    }();
+    double x[120];
+    double y[120] = {};
     double av = (double)(num_samples) / 120.0;
     double norm = num_samples;
     for (size_t i = 0; i < 120; i++) {
-        x[i] = count[i] - av;
+        x[i] = counts[i] - av;
     }
-    for (size_t i = 0; i < 120; i++) {
-        for (size_t j = 0; j < 120; j++) {
-            chi_square += x[i] * pseudoInv[i][j] * x[j];
+    for (size_t j = 0; j < 120; j++) {
+        const double *row = matrix.data() + j * 120;
+        for (size_t i = 0; i < 120; i++) {
+            y[i] += x[j] * row[i];
         }
     }
+    double chi_square = 0.0;
+    for (size_t i = 0; i < 120; i++) {
+        chi_square += x[i] * y[i];
+    }
     chi_square = std::abs(chi_square / norm);
     int degrees_of_freedom = 96;
     double p_value = utils::p_value(degrees_of_freedom / 2.0, chi_square / 2.0);
@@ -246,79 +517,63 @@ double diehard::overlapping_permutations_test(const utils::seq_bytes &bytes, int
 }
 
 double diehard::base_5_word_chi_sq(const utils::seq_bytes &bytes, int num_samples, int word_length) {
-    const double probabilities[5] = {37.0 / 256, 56.0 / 256, 70.0 / 256, 56.0 / 256, 37.0 / 256};
-    // const double mu = 2500, std = 70.7106781;
-    auto count_ones = [](uint8_t byte) {
-        int count = 0;
-        while (byte) {
-            count += byte & 1;
-            byte >>= 1;
-        }
-        return count;
-    };
+    if (word_length != 4 && word_length != 5) {
+        throw std::runtime_error("MONKEY TEST: WORD LENGTH MUST BE 4 OR 5");
+    }
+    const auto counts = base_5_word_counts(bytes, num_samples);
+    return word_counts_chi_sq(word_length == 5 ? counts.first : counts.second, num_samples);
+}
 
-    auto map_to_letter = [](int ones) {
-        if (ones <= 2)
-            return 'A';
-        if (ones == 3)
-            return 'B';
-        if (ones == 4)
-            return 'C';
-        if (ones == 5)
-            return 'D';
-        return 'E';
-    };
+double diehard::monkey_test(const utils::seq_bytes &bytes, int num_samples) {
+    // One-sided like the original monkey test, its letters start at consecutive bits and are not independent
+    boost::math::normal_distribution<double> normal_dist(word_counts_mean, word_counts_sigma);
+    return boost::math::cdf(normal_dist, word_counts_statistic(base_5_word_counts(bytes, num_samples), num_samples));
+}
 
-    std::unordered_map<std::string, int> word_count;
-    for (size_t i = 0; i <= num_samples; ++i) {
-        std::string word;
-        for (int j = 0; j < word_length; ++j) {
-            int ones = count_ones(utils::bits_to_uint<uint8_t>(bytes, i + j));
-            word += map_to_letter(ones);
-        }
-        word_count[word]++;
-    }
-    std::vector<double> observed;
-    std::vector<double> expected;
-
-    for (const auto &entry : word_count) {
-        const std::string &word = entry.first;
-        int observed_count = entry.second;
-        observed.push_back(observed_count);
-
-        double expected_count = 1.0;
-        for (char c : word) {
-            if (c == 'A')
-                expected_count *= probabilities[0];
-            else if (c == 'B')
-                expected_count *= probabilities[1];
-            else if (c == 'C')
-                expected_count *= probabilities[2];
-            else if (c == 'D')
-                expected_count *= probabilities[3];
-            else if (c == 'E')
-                expected_count *= probabilities[4];
-        }
-        expected_count *= num_samples;
-        expected.push_back(expected_count);
+double diehard::count_ones_stream_test(const utils::seq_bytes &bytes, int num_words) {
+    // Letter p is made of the byte p of the sequence
+    if (num_words < 1) {
+        throw std::runtime_error("COUNT THE ONES TEST: TOO FEW WORDS");
     }
-    int degrees_of_freedom = observed.size() - 1;
-    double chi_sq = utils::chi_square(observed, expected, degrees_of_freedom);
-    return chi_sq;
+    if (bytes.size() < (static_cast<size_t>(num_words) + 4) * 8) {
+        throw std::runtime_error("COUNT THE ONES TEST: SEQUENCE IS TOO SHORT");
+    }
+    const auto counts =
+        count_base_5_words(num_words, [&bytes](size_t p) { return letter_of_byte(bytes.data() + 8 * p); });
+    return word_counts_p_value(counts, num_words);
 }
 
-double diehard::monkey_test(const utils::seq_bytes &bytes, int num_samples) {
-    const double mu = 2500, std = 70.7106781;
+double diehard::count_ones_byte_test(const utils::seq_bytes &bytes, int num_words, int first_bit) {
+    // Letter p is made of the bits first_bit ... first_bit + 7 of the 32-bit integer p of the sequence
+    if (num_words < 1) {
+        throw std::runtime_error("COUNT THE ONES TEST: TOO FEW WORDS");
+    }
+    if (first_bit < 0 || first_bit > 24) {
+        throw std::runtime_error("COUNT THE ONES TEST: FIRST BIT IS OUT OF RANGE");
+    }
+    if (bytes.size() < (static_cast<size_t>(num_words) + 4) * 32) {
+        throw std::runtime_error("COUNT THE ONES TEST: SEQUENCE IS TOO SHORT");
+    }
+    const auto counts = count_base_5_words(
+        num_words, [&bytes, first_bit](size_t p) { return letter_of_byte(bytes.data() + 32 * p + first_bit); });
+    return word_counts_p_value(counts, num_words);
+}
 
-    double chi_sq_len_5 = base_5_word_chi_sq(bytes, num_samples, 5);
-    double chi_sq_len_4 = base_5_word_chi_sq(bytes, num_samples, 4);
-    boost::math::normal_distribution<double> normal_dist(mu, std);
-    double p_value = boost::math::cdf(normal_dist, chi_sq_len_5 - chi_sq_len_4);
-    // std::cout << "P-Value: " << p_value << std::endl;
-    return p_value;
+double diehard::count_ones_bytes_test(const utils::seq_bytes &bytes, int num_words) {
+    std::vector<double> p_values(25);
+    for (int first_bit = 0; first_bit < 25; ++first_bit) {
+        p_values[first_bit] = count_ones_byte_test(bytes, num_words, first_bit);
+    }
+    return utils::kstest(p_values);
 }
 
 double diehard::squeeze_test(const utils::seq_bytes &bytes, int num_samples) {
+    if (num_samples < 1) {
+        throw std::runtime_error("SQUEEZE TEST: TOO FEW SAMPLES");
+    }
+    if (bytes.size() < static_cast<size_t>(num_samples) * 50 * 64) {
+        throw std::runtime_error("SQUEEZE TEST: SEQUENCE IS TOO SHORT");
+    }
     std::vector<double> doubles = utils::bits_to_doubles(bytes, num_samples * 50);
     const size_t initial_k = (1u << 31) - 1;
     const size_t max_bins = 48;
@@ -334,28 +589,45 @@ double diehard::squeeze_test(const utils::seq_bytes &bytes, int num_samples) {
         expected[i] = probabilities[i] * num_samples;
     }
 
-    std::vector<double> bins(43, 0.0);
-    int global_iterations = 0;
-    for (int sample = 0; sample < num_samples; ++sample) {
-        int k = initial_k;
-        int iterations = 0;
-        // while (k > 1.0) {
-        while ((k > 1.0) && (iterations < 49)) {
-            double U = doubles[global_iterations + iterations];
-            // std::cout << k << " * " << U << std::endl;
-            k = static_cast<int>(std::ceil(k * U));
-            iterations++;
-        }
-
-        if (iterations <= min_bins) {
-            bins[0]++;
-        } else if (iterations >= max_bins) {
-            bins[max_bins - 6]++;
-        } else {
-            bins[iterations - 6]++;
-        }
-        global_iterations += iterations;
-    }
+    // Sample s multiplies by the doubles s, s + num_samples, s + 2 * num_samples, ..., so a block of consecutive
+    // samples reads consecutive doubles at every step and its lanes run in lockstep without branches
+    std::vector<size_t> counts(43, 0);
+    std::mutex counts_mutex;
+    utils::parallel_for(
+        num_samples,
+        [&](size_t first, size_t last) {
+            constexpr size_t lanes = 64;
+            std::vector<size_t> local(43, 0);
+            for (size_t block = first; block < last; block += lanes) {
+                const size_t width = std::min(lanes, last - block);
+                std::array<int, lanes> k;
+                std::array<int, lanes> iterations{};
+                k.fill(initial_k);
+                for (size_t step = 0; step < 49; ++step) {
+                    const double *U = doubles.data() + step * num_samples + block;
+                    int active_lanes = 0;
+                    for (size_t lane = 0; lane < width; ++lane) {
+                        const bool active = k[lane] > 1;
+                        const int next = static_cast<int>(std::ceil(k[lane] * U[lane]));
+                        k[lane] = active ? next : k[lane];
+                        iterations[lane] += active;
+                        active_lanes += active;
+                    }
+                    if (active_lanes == 0) {
+                        break;
+                    }
+                }
+                for (size_t lane = 0; lane < width; ++lane) {
+                    local[std::clamp<size_t>(iterations[lane], min_bins, max_bins) - 6]++;
+                }
+            }
+            std::lock_guard<std::mutex> lock(counts_mutex);
+            for (size_t i = 0; i < 43; ++i) {
+                counts[i] += local[i];
+            }
+        },
+        1 << 10);
+    std::vector<double> bins(counts.begin(), counts.end());
     double chi_square = utils::chi_square(bins, expected, 42);
     double p_value = utils::p_value(max_bins - min_bins - 1, chi_square);
     // for (size_t i = 0; i < 43; ++i) {
@@ -382,59 +654,95 @@ double diehard::sums_test(const utils::seq_bytes &bytes, int num_samples) {
 }
 
 double diehard::craps_test(const utils::seq_bytes &bytes, int num_games) {
-    std::vector<int> wins(0);
-    std::vector<int> throws(0);
-
-    // Convert bytes to numbers we can use for dice rolls
-    std::vector<uint> rolls = utils::bits_to_vector_uint<uint>(bytes, num_games * 2);
-
-    for (int game = 0; game < num_games; game++) {
-
-        int throws_this_game = 1;
-
-        // First throw - sum of two dice
-        int die1 = (rolls[game * 2] % 6) + 1;
-        int die2 = (rolls[game * 2 + 1] % 6) + 1;
-        int sum = die1 + die2;
-
-        bool game_won = false;
-        bool game_over = false;
-
-        // Check first throw results
-        if (sum == 7 || sum == 11) {
-            game_won = true;
-            game_over = true;
-        } else if (sum == 2 || sum == 3 || sum == 12) {
-            game_won = false;
-            game_over = true;
-        }
+    // Throw t < 64 of game g uses the pair of dice t * num_games + g, so every game has its own dice. The rare games
+    // longer than 64 throws continue, in the order of the games, with the pairs after the first 64 * num_games
+    if (num_games < 1) {
+        throw std::runtime_error("CRAPS TEST: TOO FEW GAMES");
+    }
+    constexpr size_t lanes = 64;
+    // A game lasts more than 64 throws with probability below 3e-9
+    constexpr size_t rounds = 64;
+    const size_t games = num_games;
+    const size_t num_pairs = bytes.size() / 64;
+    if (num_pairs < rounds * games) {
+        throw std::runtime_error("CRAPS TEST: SEQUENCE IS TOO SHORT");
+    }
 
-        // If game isn't over, we have a point
-        int point = sum;
-        while (!game_over) {
-            throws_this_game++;
-
-            // Get next roll
-            die1 = (rolls[game * 2 + throws_this_game * 2] % 6) + 1;
-            die2 = (rolls[game * 2 + throws_this_game * 2 + 1] % 6) + 1;
-            sum = die1 + die2;
-
-            if (sum == point) {
-                game_won = true;
-                game_over = true;
-            } else if (sum == 7) {
-                game_won = false;
-                game_over = true;
+    // Sum of the pair of dice i. A die is the high part of roll * 6 (Lemire's multiply-shift) instead of roll % 6
+    auto pair_sum = [&bytes](size_t i) {
+        const std::uint64_t roll1 = utils::bits_to_uint<uint>(bytes, 64 * i);
+        const std::uint64_t roll2 = utils::bits_to_uint<uint>(bytes, 64 * i + 32);
+        return static_cast<std::uint8_t>(((roll1 * 6) >> 32) + ((roll2 * 6) >> 32) + 2);
+    };
+    // One row of sums per round, so every block of lanes reads a contiguous window
+    std::vector<std::uint8_t> sums(rounds * games);
+    utils::parallel_for(
+        rounds * games,
+        [&](size_t first, size_t last) {
+            for (size_t i = first; i < last; ++i) {
+                sums[i] = pair_sum(i);
+            }
+        },
+        1 << 14);
+
+    size_t total_wins = 0;
+    // Games still undecided after the last round with their points
+    std::vector<std::pair<size_t, std::uint8_t>> unfinished;
+    std::mutex wins_mutex;
+    utils::parallel_for(
+        num_games,
+        [&](size_t first, size_t last) {
+            size_t local_wins = 0;
+            std::vector<std::pair<size_t, std::uint8_t>> local_unfinished;
+            for (size_t block = first; block < last; block += lanes) {
+                const size_t width = std::min(lanes, last - block);
+                // The games of a block run in lockstep, a decided game is masked out of the later throws
+                std::array<std::uint8_t, lanes> point;
+                std::array<std::uint8_t, lanes> active;
+                std::array<std::uint8_t, lanes> won;
+                for (size_t lane = 0; lane < width; ++lane) {
+                    const std::uint8_t sum = sums[block + lane];
+                    won[lane] = sum == 7 || sum == 11;
+                    active[lane] = !won[lane] && sum != 2 && sum != 3 && sum != 12;
+                    point[lane] = sum;
+                }
+                bool any = true;
+                for (size_t round = 1; round < rounds && any; ++round) {
+                    const std::uint8_t *window = sums.data() + round * games + block;
+                    std::uint8_t active_lanes = 0;
+                    for (size_t lane = 0; lane < width; ++lane) {
+                        const std::uint8_t sum = window[lane];
+                        won[lane] |= active[lane] & (sum == point[lane]);
+                        active[lane] &= (sum != point[lane]) & (sum != 7);
+                        active_lanes |= active[lane];
+                    }
+                    any = active_lanes != 0;
+                }
+                for (size_t lane = 0; lane < width; ++lane) {
+                    local_wins += won[lane];
+                    if (active[lane]) {
+                        local_unfinished.emplace_back(block + lane, point[lane]);
+                    }
+                }
+            }
+            std::lock_guard<std::mutex> lock(wins_mutex);
+            total_wins += local_wins;
+            unfinished.insert(unfinished.end(), local_unfinished.begin(), local_unfinished.end());
+        },
+        1 << 12);
+
+    std::sort(unfinished.begin(), unfinished.end());
+    size_t next_pair = rounds * games;
+    for (const auto &[game, point] : unfinished) {
+        for (std::uint8_t sum = 0; sum != point && sum != 7;) {
+            if (next_pair == num_pairs) {
+                throw std::runtime_error("CRAPS TEST: SEQUENCE IS TOO SHORT");
             }
+            sum = pair_sum(next_pair++);
+            total_wins += sum == point;
         }
-
-        wins.push_back(game_won ? 1 : 0);
-        throws.push_back(throws_this_game);
     }
 
-    // Count total wins
-    int total_wins = std::accumulate(wins.begin(), wins.end(), 0);
-
     // Expected values
     double p = 244.0 / 495.0;
     double expected_wins = num_games * p;
@@ -448,3 +756,15 @@ double diehard::craps_test(const utils::seq_bytes &bytes, int num_games) {
     double p_value = std::erfc(z_score / std::sqrt(2.0));
     return p_value;
 }
+
+double diehard::opso_test(const utils::seq_bytes &bytes, int num_repetitions) {
+    return sparse_occupancy_test(bytes, "OPSO", 10, 290, num_repetitions);
+}
+
+double diehard::oqso_test(const utils::seq_bytes &bytes, int num_repetitions) {
+    return sparse_occupancy_test(bytes, "OQSO", 5, 295, num_repetitions);
+}
+
+double diehard::dna_test(const utils::seq_bytes &bytes, int num_repetitions) {
+    return sparse_occupancy_test(bytes, "DNA", 2, 339, num_repetitions);
+}
@@ -0,0 +1,499 @@
+#include "metrics/fft.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <list>
+#include <mutex>
+#include <numbers>
+#include <stdexcept>
+
+#include "metrics/thread_pool.hpp"
+
+namespace {
+
+// std::complex multiplication checks for infinities and NaNs, which is not needed for unit twiddles
+template <typename Real>
+inline std::complex<Real> multiply(const std::complex<Real> &a, const std::complex<Real> &b) {
+    return {a.real() * b.real() - a.imag() * b.imag(), a.real() * b.imag() + a.imag() * b.real()};
+}
+
+// -i * a
+template <typename Real>
+inline std::complex<Real> rotate(const std::complex<Real> &a) {
+    return {a.imag(), -a.real()};
+}
+
+template <typename Real>
+std::complex<Real> unit_root(size_t k, size_t n) {
+    const std::double_t angle = -2.0 * std::numbers::pi * static_cast<std::double_t>(k) / n;
+    return {static_cast<Real>(std::cos(angle)), static_cast<Real>(std::sin(angle))};
+}
+
+bool is_power_of_two(size_t size) {
+    return size >= 1 && (size & (size - 1)) == 0;
+}
+
+size_t log2_exact(size_t size) {
+    size_t log2 = 0;
+    while ((size_t(1) << log2) < size) {
+        log2++;
+    }
+    return log2;
+}
+
+std::vector<std::uint32_t> bit_reversal(size_t size) {
+    std::vector<std::uint32_t> reverse(size);
+    const size_t log2 = log2_exact(size);
+    for (size_t i = 1; i < size; ++i) {
+        reverse[i] = static_cast<std::uint32_t>((reverse[i >> 1] >> 1) | ((i & 1) << (log2 - 1)));
+    }
+    return reverse;
+}
+
+// In-place radix-2 FFT of bit-reversed data; stage_twiddles(m2) returns the twiddles of the stage with half block
+// size m2, exp(-2 * pi * i * j / (2 * m2)) for j < m2
+template <typename Real, typename StageTwiddles>
+void radix2(std::complex<Real> *data, size_t size, StageTwiddles &&stage_twiddles) {
+    for (size_t m2 = 1; m2 < size; m2 <<= 1) {
+        const std::complex<Real> *w = stage_twiddles(m2);
+        for (size_t k = 0; k < size; k += 2 * m2) {
+            std::complex<Real> *even = data + k;
+            std::complex<Real> *odd = even + m2;
+            for (size_t j = 0; j < m2; ++j) {
+                const std::complex<Real> t = multiply(odd[j], w[j]);
+                odd[j] = even[j] - t;
+                even[j] += t;
+            }
+        }
+    }
+}
+
+// Tile edge of the blocked transposes: two 32 x 32 tiles of complex<double> take 32 KB.
+// Six-step rows and columns are at least 2^11, so the tiles always divide them
+constexpr size_t transpose_tile = 32;
+// Rows loaded together in the first six-step pass: 16 rows read one 32-byte run of the input per column
+constexpr size_t load_tile = 16;
+
+} // namespace
+
+namespace utils {
+
+template <typename Real>
+ComplexFFTPlan<Real>::ComplexFFTPlan(size_t size) : size_(size) {
+    if (size == 0) {
+        throw std::invalid_argument("ComplexFFTPlan requires a non-empty input");
+    }
+    if (!is_smooth(size)) {
+        size_t inner_size = next_smooth(2 * size - 1);
+        inner = std::make_unique<const ComplexFFTPlan>(inner_size);
+        chirp.resize(size);
+        // k^2 mod 2 * size keeps the angle exact for large k. It is updated as (k + 1)^2 = k^2 + 2 * k + 1, so k * k
+        // never overflows
+        size_t square = 0;
+        for (size_t k = 0; k < size; ++k) {
+            chirp[k] = unit_root<Real>(square, 2 * size);
+            square += 2 * k + 1;
+            if (square >= 2 * size) {
+                square -= 2 * size;
+            }
+        }
+        std::vector<std::complex<Real>> b(inner_size, 0);
+        b[0] = std::conj(chirp[0]);
+        for (size_t k = 1; k < size; ++k) {
+            b[k] = std::conj(chirp[k]);
+            b[inner_size - k] = std::conj(chirp[k]);
+        }
+        chirp_spectrum.resize(inner_size);
+        inner->transform(b.data(), chirp_spectrum.data());
+        return;
+    }
+    size_t rest = size;
+    for (size_t p : {4, 2, 3, 5}) {
+        while (rest % p == 0) {
+            factors.push_back(p);
+            rest /= p;
+        }
+    }
+    twiddles.resize(size);
+    for (size_t k = 0; k < size; ++k) {
+        twiddles[k] = unit_root<Real>(k, size);
+    }
+}
+
+template <typename Real>
+bool ComplexFFTPlan<Real>::is_smooth(size_t size) {
+    for (size_t p : {2, 3, 5}) {
+        while (size > 1 && size % p == 0) {
+            size /= p;
+        }
+    }
+    return size == 1;
+}
+
+template <typename Real>
+size_t ComplexFFTPlan<Real>::next_smooth(size_t size) {
+    while (!is_smooth(size)) {
+        size++;
+    }
+    return size;
+}
+
+template <typename Real>
+size_t ComplexFFTPlan<Real>::size() const {
+    return size_;
+}
+
+template <typename Real>
+void ComplexFFTPlan<Real>::butterfly(std::complex<Real> *out, size_t stride, size_t m, size_t p) const {
+    // out[q * m + k] holds coefficient k of the q-th decimated subsequence; the p-point DFT of
+    // out[q * m + k] * W^{q * k} gives coefficients k + r * m of the whole subsequence
+    const Real half = 0.5;
+    const Real sin3 = static_cast<Real>(std::sin(2.0 * std::numbers::pi / 3.0));
+    const Real cos5_1 = static_cast<Real>(std::cos(2.0 * std::numbers::pi / 5.0));
+    const Real cos5_2 = static_cast<Real>(std::cos(4.0 * std::numbers::pi / 5.0));
+    const Real sin5_1 = static_cast<Real>(std::sin(2.0 * std::numbers::pi / 5.0));
+    const Real sin5_2 = static_cast<Real>(std::sin(4.0 * std::numbers::pi / 5.0));
+    for (size_t k = 0; k < m; ++k) {
+        std::complex<Real> t[5];
+        t[0] = out[k];
+        for (size_t q = 1; q < p; ++q) {
+            t[q] = multiply(out[q * m + k], twiddles[q * k * stride]);
+        }
+        switch (p) {
+        case 2:
+            out[k] = t[0] + t[1];
+            out[m + k] = t[0] - t[1];
+            break;
+        case 3: {
+            const std::complex<Real> sum = t[1] + t[2];
+            const std::complex<Real> diff = rotate(t[1] - t[2]) * sin3;
+            const std::complex<Real> base = t[0] - sum * half;
+            out[k] = t[0] + sum;
+            out[m + k] = base + diff;
+            out[2 * m + k] = base - diff;
+            break;
+        }
+        case 4: {
+            const std::complex<Real> sum02 = t[0] + t[2];
+            const std::complex<Real> diff02 = t[0] - t[2];
+            const std::complex<Real> sum13 = t[1] + t[3];
+            const std::complex<Real> diff13 = rotate(t[1] - t[3]);
+            out[k] = sum02 + sum13;
+            out[m + k] = diff02 + diff13;
+            out[2 * m + k] = sum02 - sum13;
+            out[3 * m + k] = diff02 - diff13;
+            break;
+        }
+        case 5: {
+            const std::complex<Real> a1 = t[1] + t[4];
+            const std::complex<Real> b1 = t[1] - t[4];
+            const std::complex<Real> a2 = t[2] + t[3];
+            const std::complex<Real> b2 = t[2] - t[3];
+            const std::complex<Real> base1 = t[0] + a1 * cos5_1 + a2 * cos5_2;
+            const std::complex<Real> base2 = t[0] + a1 * cos5_2 + a2 * cos5_1;
+            const std::complex<Real> rot1 = rotate(b1 * sin5_1 + b2 * sin5_2);
+            const std::complex<Real> rot2 = rotate(b1 * sin5_2 - b2 * sin5_1);
+            out[k] = t[0] + a1 + a2;
+            out[m + k] = base1 + rot1;
+            out[4 * m + k] = base1 - rot1;
+            out[2 * m + k] = base2 + rot2;
+            out[3 * m + k] = base2 - rot2;
+            break;
+        }
+        }
+    }
+}
+
+template <typename Real>
+void ComplexFFTPlan<Real>::mixed_radix(std::complex<Real> *out, const std::complex<Real> *in, size_t stride, size_t n,
+                                       const size_t *factor) const {
+    const size_t p = *factor;
+    const size_t m = n / p;
+    if (m == 1) {
+        for (size_t q = 0; q < p; ++q) {
+            out[q] = in[q * stride];
+        }
+    } else {
+        for (size_t q = 0; q < p; ++q) {
+            mixed_radix(out + q * m, in + q * stride, stride * p, m, factor + 1);
+        }
+    }
+    // n * stride == size on every level, so W_n^j = W_size^{j * stride}
+    butterfly(out, stride, m, p);
+}
+
+template <typename Real>
+void ComplexFFTPlan<Real>::transform(const std::complex<Real> *in, std::complex<Real> *out) const {
+    if (!inner) {
+        if (size_ == 1) {
+            out[0] = in[0];
+            return;
+        }
+        mixed_radix(out, in, 1, size_, factors.data());
+        return;
+    }
+    // X_k = chirp_k * sum_j (x_j * chirp_j) * conj(chirp_{k - j}) is a cyclic convolution of the inner size
+    const size_t inner_size = inner->size();
+    std::vector<std::complex<Real>> a(inner_size, 0);
+    for (size_t k = 0; k < size_; ++k) {
+        a[k] = multiply(in[k], chirp[k]);
+    }
+    std::vector<std::complex<Real>> A(inner_size);
+    inner->transform(a.data(), A.data());
+    // Inverse transform as conj(FFT(conj(x))) / inner_size
+    for (size_t k = 0; k < inner_size; ++k) {
+        A[k] = std::conj(multiply(A[k], chirp_spectrum[k]));
+    }
+    inner->transform(A.data(), a.data());
+    const Real scale = Real(1) / static_cast<Real>(inner_size);
+    for (size_t k = 0; k < size_; ++k) {
+        out[k] = multiply(std::conj(a[k]) * scale, chirp[k]);
+    }
+}
+
+template <typename Real>
+RealFFTPlan<Real>::RealFFTPlan(size_t size) : size_(size), half(size % 2 == 0 ? size / 2 : size) {
+    if (!supports(size)) {
+        throw std::invalid_argument("RealFFTPlan requires a non-empty input");
+    }
+    if (size % 2 == 0) {
+        split.resize(half);
+        for (size_t k = 0; k < half; ++k) {
+            split[k] = unit_root<Real>(k, size);
+        }
+    }
+    if (size % 2 != 0 || !is_power_of_two(size)) {
+        general = std::make_unique<const ComplexFFTPlan<Real>>(half);
+        return;
+    }
+    if (size >= blocked_threshold) {
+        const size_t log2_half = log2_exact(half);
+        columns = size_t(1) << (log2_half / 2);
+        rows = half / columns;
+        row_bit_reverse = bit_reversal(rows);
+        column_bit_reverse = bit_reversal(columns);
+        step_coarse.resize(rows);
+        for (size_t i = 0; i < rows; ++i) {
+            step_coarse[i] = unit_root<Real>(i * columns, half);
+        }
+        step_fine.resize(columns);
+        for (size_t j = 0; j < columns; ++j) {
+            step_fine[j] = unit_root<Real>(j, half);
+        }
+        // The rows and columns only need the stages below rows, twiddles of the stage m2 are in [m2, 2 * m2)
+        row_twiddles.resize(rows);
+        for (size_t m2 = 1; m2 < rows; m2 <<= 1) {
+            for (size_t j = 0; j < m2; ++j) {
+                row_twiddles[m2 + j] = split[j * (size / (2 * m2))];
+            }
+        }
+    } else {
+        bit_reverse = bit_reversal(half);
+    }
+}
+
+template <typename Real>
+std::shared_ptr<const RealFFTPlan<Real>> RealFFTPlan<Real>::get(size_t size) {
+    static std::mutex mutex;
+    static std::list<std::shared_ptr<const RealFFTPlan>> plans;
+    std::lock_guard<std::mutex> lock(mutex);
+    // Only the most recently used sizes are kept, the plan of a size is about as large as its transform
+    auto found = std::find_if(plans.begin(), plans.end(), [size](const auto &plan) { return plan->size() == size; });
+    if (found != plans.end()) {
+        plans.splice(plans.begin(), plans, found);
+        return plans.front();
+    }
+    plans.push_front(std::make_shared<const RealFFTPlan>(size));
+    if (plans.size() > cached_plans) {
+        plans.pop_back();
+    }
+    return plans.front();
+}
+
+template <typename Real>
+bool RealFFTPlan<Real>::supports(size_t size) {
+    return size >= 1;
+}
+
+template <typename Real>
+size_t RealFFTPlan<Real>::size() const {
+    return size_;
+}
+
+template <typename Real>
+void RealFFTPlan<Real>::transform_half(const seq_bytes &bytes, std::vector<std::complex<Real>> &z) const {
+    z.resize(half);
+    if (general) {
+        // z_j = x_{2j} + i * x_{2j+1} for even sizes and z_j = x_j for odd ones
+        std::vector<std::complex<Real>> input(half);
+        if (size_ % 2 == 0) {
+            for (size_t j = 0; j < half; ++j) {
+                input[j] = {static_cast<Real>(2 * bytes[2 * j] - 1), static_cast<Real>(2 * bytes[2 * j + 1] - 1)};
+            }
+        } else {
+            for (size_t j = 0; j < half; ++j) {
+                input[j] = static_cast<Real>(2 * bytes[j] - 1);
+            }
+        }
+        general->transform(input.data(), z.data());
+        return;
+    }
+    if (rows != 0) {
+        transform_six_step(bytes, z);
+        return;
+    }
+    // z_j = x_{2j} + i * x_{2j+1}, written in bit-reversed order
+    for (size_t j = 0; j < half; ++j) {
+        z[bit_reverse[j]] = {static_cast<Real>(2 * bytes[2 * j] - 1), static_cast<Real>(2 * bytes[2 * j + 1] - 1)};
+    }
+    // The twiddles of stage m2 are every size / (2 * m2)-th split factor, gathered once per stage so that the blocks
+    // of the stage read them contiguously
+    std::vector<std::complex<Real>> stage(half / 2);
+    radix2(z.data(), half, [&](size_t m2) {
+        const size_t stride = size_ / (2 * m2);
+        for (size_t j = 0; j < m2; ++j) {
+            stage[j] = split[j * stride];
+        }
+        return stage.data();
+    });
+}
+
+template <typename Real>
+void RealFFTPlan<Real>::transform_six_step(const seq_bytes &bytes, std::vector<std::complex<Real>> &z) const {
+    // With j = n1 + rows * n2 and k = k2 + columns * k1:
+    // Z_k = sum_{n1} W_rows^{n1 * k1} * W_half^{n1 * k2} * sum_{n2} W_columns^{n2 * k2} * z_j
+    const auto w = [this](size_t m2) { return row_twiddles.data() + m2; };
+    const size_t column_shift = std::countr_zero(columns);
+    std::vector<std::complex<Real>> transposed(half);
+    std::complex<Real> *A = z.data();
+    std::complex<Real> *B = transposed.data();
+    // 1. A[n1][n2] = z_{n1 + rows * n2} in bit-reversed order, then FFT of every row of length columns.
+    // A tile of rows reads adjacent input bytes, so the input is streamed once
+    parallel_for(rows / load_tile, [&](size_t first, size_t last) {
+        for (size_t n1_tile = first * load_tile; n1_tile < last * load_tile; n1_tile += load_tile) {
+            for (size_t n2 = 0; n2 < columns; ++n2) {
+                const unsigned char *input = bytes.data() + 2 * (n1_tile + rows * n2);
+                std::complex<Real> *output = A + n1_tile * columns + column_bit_reverse[n2];
+                for (size_t r = 0; r < load_tile; ++r) {
+                    output[r * columns] = {static_cast<Real>(2 * input[2 * r] - 1),
+                                           static_cast<Real>(2 * input[2 * r + 1] - 1)};
+                }
+            }
+            for (size_t r = 0; r < load_tile; ++r) {
+                radix2(A + (n1_tile + r) * columns, columns, w);
+            }
+        }
+    });
+    // 2. B[k2][n1] = A[n1][k2] * W_half^{n1 * k2}, transposed by tiles
+    const size_t column_tiles = columns / transpose_tile;
+    parallel_for(rows / transpose_tile * column_tiles, [&](size_t first, size_t last) {
+        for (size_t tile = first; tile < last; ++tile) {
+            const size_t n1_tile = tile / column_tiles * transpose_tile;
+            const size_t k2_tile = tile % column_tiles * transpose_tile;
+            for (size_t k2 = k2_tile; k2 < k2_tile + transpose_tile; ++k2) {
+                for (size_t n1 = n1_tile; n1 < n1_tile + transpose_tile; ++n1) {
+                    const size_t e = n1 * k2;
+                    const std::complex<Real> step =
+                        multiply(step_coarse[e >> column_shift], step_fine[e & (columns - 1)]);
+                    B[k2 * rows + n1] = multiply(A[n1 * columns + k2], step);
+                }
+            }
+        }
+    });
+    // 3. FFT of every row of B of length rows, B[k2][k1] = Z_{k2 + columns * k1}.
+    // The bit-reversal permutation goes through a row buffer that stays in cache
+    parallel_for(columns, [&](size_t first, size_t last) {
+        std::vector<std::complex<Real>> buffer(rows);
+        for (size_t k2 = first; k2 < last; ++k2) {
+            std::complex<Real> *row = B + k2 * rows;
+            for (size_t n1 = 0; n1 < rows; ++n1) {
+                buffer[row_bit_reverse[n1]] = row[n1];
+            }
+            radix2(buffer.data(), rows, w);
+            std::copy(buffer.begin(), buffer.end(), row);
+        }
+    });
+    // 4. z_{k1 * columns + k2} = B[k2][k1], transposed by tiles
+    parallel_for(rows / transpose_tile * column_tiles, [&](size_t first, size_t last) {
+        for (size_t tile = first; tile < last; ++tile) {
+            const size_t k1_tile = tile / column_tiles * transpose_tile;
+            const size_t k2_tile = tile % column_tiles * transpose_tile;
+            for (size_t k1 = k1_tile; k1 < k1_tile + transpose_tile; ++k1) {
+                for (size_t k2 = k2_tile; k2 < k2_tile + transpose_tile; ++k2) {
+                    A[k1 * columns + k2] = B[k2 * rows + k1];
+                }
+            }
+        }
+    });
+}
+
+template <typename Real>
+std::vector<std::complex<Real>> RealFFTPlan<Real>::transform(const seq_bytes &bytes) const {
+    std::vector<std::complex<Real>> z;
+    transform_half(bytes, z);
+    if (size_ % 2 != 0) {
+        z.resize(size_ / 2);
+        return z;
+    }
+    // X_k = E_k + W^k * O_k, where E and O are spectra of the even and odd samples:
+    // E_k = (Z_k + conj(Z_{h-k})) / 2, O_k = (Z_k - conj(Z_{h-k})) / 2i
+    std::vector<std::complex<Real>> X(half);
+    // Only the six-step sizes are worth splitting across threads
+    const size_t grain = rows != 0 ? blocked_threshold / 16 : half;
+    parallel_for(
+        half,
+        [&](size_t first, size_t last) {
+            for (size_t k = first; k < last; ++k) {
+                const std::complex<Real> a = z[k];
+                const std::complex<Real> b = std::conj(z[k == 0 ? 0 : half - k]);
+                const std::complex<Real> even = (a + b) * Real(0.5);
+                const std::complex<Real> odd = rotate((a - b) * Real(0.5));
+                X[k] = even + multiply(split[k], odd);
+            }
+        },
+        grain);
+    return X;
+}
+
+template <typename Real>
+size_t RealFFTPlan<Real>::count_below(const seq_bytes &bytes, Real threshold) const {
+    std::vector<std::complex<Real>> z;
+    transform_half(bytes, z);
+    const Real threshold2 = threshold * threshold;
+    size_t count = 0;
+    if (size_ % 2 != 0) {
+        for (size_t k = 0; k < size_ / 2; ++k) {
+            count += std::norm(z[k]) < threshold2;
+        }
+        return count;
+    }
+    // The split pass of transform fused with the threshold test
+    std::atomic<size_t> total = 0;
+    const size_t grain = rows != 0 ? blocked_threshold / 16 : half;
+    parallel_for(
+        half,
+        [&](size_t first, size_t last) {
+            size_t local = 0;
+            for (size_t k = first; k < last; ++k) {
+                const std::complex<Real> a = z[k];
+                const std::complex<Real> b = std::conj(z[k == 0 ? 0 : half - k]);
+                const std::complex<Real> even = (a + b) * Real(0.5);
+                const std::complex<Real> odd = rotate((a - b) * Real(0.5));
+                const std::complex<Real> X = even + multiply(split[k], odd);
+                local += std::norm(X) < threshold2;
+            }
+            total += local;
+        },
+        grain);
+    return total;
+}
+
+template class ComplexFFTPlan<std::double_t>;
+template class ComplexFFTPlan<std::float_t>;
+
+template class RealFFTPlan<std::double_t>;
+template class RealFFTPlan<std::float_t>;
+
+} // namespace utils
@@ -1,26 +1,83 @@
 #include "statistical_test/nist.hpp"
 
+#include "metrics/thread_pool.hpp"
 #include "metrics/utils.hpp"
 
 #include <algorithm>
+#include <exception>
 #include <filesystem>
+#include <functional>
+#include <numeric>
 #include <sstream>
 #include <stdexcept>
 #include <system_error>
+#include <utility>
 
 #include <boost/math/special_functions/gamma.hpp>
 
 namespace statistical_test {
 
-NistTest::NistTest(const double &alpha)
-    : StatisticalTest(alpha), test_success(40, 0), save_p_values(40), test_errors(15) {
+namespace {
+
+std::string template_to_string(const utils::seq_bytes &template_) {
+    std::string result;
+    for (unsigned char bit : template_) {
+        result += static_cast<char>('0' + bit);
+    }
+    return result;
+}
+
+// One or several tests run as a single task of NistTest::test
+struct TestJob {
+    // Slots of test_names filled with the p-values returned by run
+    std::vector<size_t> slots;
+    // Slots of test_errors for a std::runtime_error of run, without them the error is rethrown to the caller
+    std::vector<size_t> error_slots;
+    std::function<std::vector<std::double_t>()> run;
+
+    // Results of execute
+    std::vector<std::double_t> p_values;
+    std::string error;
+    std::exception_ptr exception;
+
+    TestJob(std::vector<size_t> slots, std::vector<size_t> error_slots, std::function<std::vector<std::double_t>()> run)
+        : slots(std::move(slots)), error_slots(std::move(error_slots)), run(std::move(run)) {
+    }
+
+    void execute() {
+        try {
+            p_values = run();
+        } catch (const std::runtime_error &e) {
+            if (error_slots.empty()) {
+                exception = std::current_exception();
+            } else {
+                error = e.what();
+            }
+        } catch (...) {
+            exception = std::current_exception();
+        }
+    }
+};
+
+} // namespace
+
+NistTest::NistTest(const double &alpha, size_t threads)
+    : StatisticalTest(alpha), test_names(base_test_names.begin(), base_test_names.end()),
+      templates(nist::aperiodic_templates(template_length)), test_errors(15), threads(threads) {
+    test_names[6] += " " + template_to_string(templates[0]);
+    for (size_t t = 1; t < templates.size(); ++t) {
+        test_names.push_back(std::string(base_test_names[6]) + " " + template_to_string(templates[t]));
+    }
+    test_success.assign(test_names.size(), 0);
+    save_p_values.resize(test_names.size());
 }
 
 void NistTest::test(const utils::seq_bytes &bytes, const bool &print_p_values) {
     ++test_count;
-    std::string num_test = std::to_string(test_count) + ". ";
+    // Counts and packed words shared by several tests, each released after its last consumer
+    utils::SequenceAnalysis analysis(bytes);
     {
-        std::double_t p_value = nist::frequency_test(bytes);
+        std::double_t p_value = nist::frequency_test(analysis);
         if (print_p_values) {
             std::cout << test_names[0] << ": " << p_value << std::endl;
         }
@@ -28,7 +85,7 @@ void NistTest::test(const utils::seq_bytes &bytes, const bool &print_p_values) {
         bool res = compare_p_value(p_value);
         test_success[0] += res;
         if (!res) {
-            for (size_t i = 1; i < 40; i++) {
+            for (size_t i = 1; i < test_names.size(); i++) {
                 save_p_values[i].push_back(0.0);
                 test_success[i] += false;
             }
@@ -36,178 +93,114 @@ void NistTest::test(const utils::seq_bytes &bytes, const bool &print_p_values) {
         }
     }
 
-    {
-        std::double_t p_value = nist::frequency_block_test(bytes, 128);
-        if (print_p_values) {
-            std::cout << test_names[1] << ": " << p_value << std::endl;
-        }
-        save_p_values[1].push_back(p_value);
-        test_success[1] += compare_p_value(p_value);
+    std::vector<size_t> template_slots(templates.size());
+    for (size_t t = 0; t < templates.size(); ++t) {
+        template_slots[t] = t == 0 ? 6 : base_test_names.size() - 1 + t;
     }
+    std::vector<size_t> excursion_slots(26);
+    std::iota(excursion_slots.begin(), excursion_slots.end(), 15);
 
-    {
-        std::double_t p_value = nist::runs_test(bytes);
-        if (print_p_values) {
-            std::cout << test_names[2] << ": " << p_value << std::endl;
-        }
-        save_p_values[2].push_back(p_value);
-        test_success[2] += compare_p_value(p_value);
-    }
+    // The remaining tests only read the sequence, so they run concurrently as a task graph. The results are stored
+    // in the order of the slots, whatever order the jobs finish in
+    std::vector<TestJob> jobs;
+    jobs.push_back({template_slots, {}, [&] { return nist::non_overlapping_template_matching(bytes, templates); }});
+    jobs.push_back({{5}, {}, [&] { return std::vector{nist::discrete_fourier_transform(bytes)}; }});
+    jobs.push_back({{9}, {9}, [&] { return std::vector{nist::linear_complexity(bytes, 500)}; }});
+    const size_t serial = jobs.size();
+    jobs.push_back({{10, 11}, {}, [&] {
+                        auto [p_value1, p_value2] = nist::serial_complexity(analysis, 16);
+                        return std::vector{p_value1, p_value2};
+                    }});
+    // Runs after the serial test, so that the order 11 and 10 counts are marginalized from the order 16 ones
+    const size_t entropy = jobs.size();
+    jobs.push_back({{12}, {}, [&] {
+                        std::double_t p_value = nist::approximate_entropy(analysis, 10);
+                        analysis.release_pattern_counts();
+                        return std::vector{p_value};
+                    }});
+    jobs.push_back({excursion_slots, {13, 14}, [&] {
+                        // Both tests use the same cycles, so they fail together
+                        auto [p_values, p_values_variant] = nist::random_excursions_and_variant(bytes);
+                        p_values.insert(p_values.end(), p_values_variant.begin(), p_values_variant.end());
+                        return p_values;
+                    }});
+    jobs.push_back({{4}, {4}, [&] { return std::vector{nist::binary_matrix_rank(bytes, 32, 32)}; }});
+    jobs.push_back({{7}, {}, [&] {
+                        utils::seq_bytes template_ = {1, 1, 1, 1, 1, 1, 1, 1, 1};
+                        return std::vector{nist::overlapping_template_matching(bytes, template_, 1032, 0)};
+                    }});
+    jobs.push_back({{8}, {8}, [&] {
+                        std::vector<std::double_t> p_values;
+                        try {
+                            p_values.push_back(nist::universal(analysis));
+                        } catch (...) {
+                            analysis.release_packed_bits();
+                            throw;
+                        }
+                        analysis.release_packed_bits();
+                        return p_values;
+                    }});
+    jobs.push_back({{1}, {}, [&] { return std::vector{nist::frequency_block_test(bytes, 128)}; }});
+    jobs.push_back({{3}, {}, [&] { return std::vector{nist::longest_run_of_ones(bytes)}; }});
+    jobs.push_back({{2}, {}, [&] { return std::vector{nist::runs_test(analysis)}; }});
+    jobs.push_back({{13, 14}, {}, [&] {
+                        auto [p_value1, p_value2] = nist::cumulative_sums(bytes);
+                        return std::vector{p_value1, p_value2};
+                    }});
 
-    {
-        std::double_t p_value = nist::longest_run_of_ones(bytes);
-        if (print_p_values) {
-            std::cout << test_names[3] << ": " << p_value << std::endl;
-        }
-        save_p_values[3].push_back(p_value);
-        test_success[3] += compare_p_value(p_value);
+    // Jobs are listed from the most expensive one, so that the cheap ones fill the gaps at the end
+    utils::TaskGraph graph;
+    for (size_t j = 0; j < jobs.size(); ++j) {
+        graph.add([&jobs, j] { jobs[j].execute(); }, j == entropy ? std::vector<size_t>{serial} : std::vector<size_t>{});
     }
+    graph.run(threads);
 
-    {
-        try {
-            std::double_t p_value = nist::binary_matrix_rank(bytes, 32, 32);
-            if (print_p_values) {
-                std::cout << test_names[4] << ": " << p_value << std::endl;
-            }
-            save_p_values[4].push_back(p_value);
-            test_success[4] += compare_p_value(p_value);
-        } catch (const std::runtime_error &e) {
-            test_errors[4].push_back(num_test + e.what());
-            save_p_values[4].push_back(0.0);
+    std::sort(jobs.begin(), jobs.end(),
+              [](const TestJob &lhs, const TestJob &rhs) { return lhs.slots.front() < rhs.slots.front(); });
+    for (const TestJob &job : jobs) {
+        if (job.exception) {
+            std::rethrow_exception(job.exception);
         }
-    }
-
-    {
-        std::double_t p_value = nist::discrete_fourier_transform(bytes);
-        if (print_p_values) {
-            std::cout << test_names[5] << ": " << p_value << std::endl;
-        }
-        save_p_values[5].push_back(p_value);
-        test_success[5] += compare_p_value(p_value);
-    }
-
-    {
-        utils::seq_bytes template_ = {0, 0, 0, 0, 0, 0, 0, 0, 1};
-        std::double_t p_value = nist::non_overlapping_template_matching(bytes, template_);
-        if (print_p_values) {
-            std::cout << test_names[6] << ": " << p_value << std::endl;
-        }
-        save_p_values[6].push_back(p_value);
-        test_success[6] += compare_p_value(p_value);
-    }
-
-    {
-        utils::seq_bytes template_ = {1, 1, 1, 1, 1, 1, 1, 1, 1};
-        std::double_t p_value = nist::overlapping_template_matching(bytes, template_);
-        if (print_p_values) {
-            std::cout << test_names[7] << ": " << p_value << std::endl;
-        }
-        save_p_values[7].push_back(p_value);
-        test_success[7] += compare_p_value(p_value);
-    }
-
-    {
-        try {
-            std::double_t p_value = nist::universal(bytes);
-            if (print_p_values) {
-                std::cout << test_names[8] << ": " << p_value << std::endl;
+        if (!job.error.empty()) {
+            for (size_t slot : job.error_slots) {
+                test_errors[slot].emplace_back(test_count, job.error);
             }
-            save_p_values[8].push_back(p_value);
-            test_success[8] += compare_p_value(p_value);
-        } catch (const std::runtime_error &e) {
-            test_errors[8].push_back(num_test + e.what());
-            save_p_values[8].push_back(0.0);
+            for (size_t slot : job.slots) {
+                save_p_values[slot].push_back(0.0);
+            }
+            continue;
         }
-    }
-
-    {
-        try {
-            std::double_t p_value = nist::linear_complexity(bytes, 500);
+        for (size_t i = 0; i < job.slots.size(); ++i) {
+            size_t slot = job.slots[i];
             if (print_p_values) {
-                std::cout << test_names[9] << ": " << p_value << std::endl;
+                std::cout << test_names[slot] << ": " << job.p_values[i] << std::endl;
             }
-            save_p_values[9].push_back(p_value);
-            test_success[9] += compare_p_value(p_value);
-        } catch (const std::runtime_error &e) {
-            test_errors[9].push_back(num_test + e.what());
-            save_p_values[9].push_back(0.0);
-        }
-    }
-
-    {
-        auto [p_value1, p_value2] = nist::serial_complexity(bytes, 16);
-        if (print_p_values) {
-            std::cout << test_names[10] << ": " << p_value1 << " " << test_names[11] << ": " << p_value2 << std::endl;
+            save_p_values[slot].push_back(job.p_values[i]);
+            test_success[slot] += compare_p_value(job.p_values[i]);
         }
-        save_p_values[10].push_back(p_value1);
-        test_success[10] += compare_p_value(p_value1);
-        save_p_values[11].push_back(p_value2);
-        test_success[11] += compare_p_value(p_value2);
     }
+}
 
-    {
-        std::double_t p_value = nist::approximate_entropy(bytes, 10);
-        if (print_p_values) {
-            std::cout << test_names[12] << ": " << p_value << std::endl;
-        }
-        save_p_values[12].push_back(p_value);
-        test_success[12] += compare_p_value(p_value);
+void NistTest::merge(const NistTest &other) {
+    if (other.alpha != alpha || other.test_names != test_names) {
+        throw std::invalid_argument("Merged Nist tests must have the same alpha and tests");
     }
-
-    {
-        std::double_t p_value = nist::cumulative_sums(bytes, nist::CumulativeSumsMode::Forward);
-        if (print_p_values) {
-            std::cout << test_names[13] << ": " << p_value << std::endl;
-        }
-        save_p_values[13].push_back(p_value);
-        test_success[13] += compare_p_value(p_value);
+    for (size_t i = 0; i < test_names.size(); ++i) {
+        test_success[i] += other.test_success[i];
+        save_p_values[i].insert(save_p_values[i].end(), other.save_p_values[i].begin(), other.save_p_values[i].end());
     }
-
-    {
-        try {
-            std::vector<std::double_t> p_values = nist::random_excursions(bytes);
-            assert(p_values.size() == 8);
-            for (int s = -4, i = 0; s <= 4; ++s) {
-                if (s == 0) {
-                    continue;
-                }
-                if (print_p_values) {
-                    std::cout << test_names[14 + i] << ": p-value = " << p_values[i] << "\n";
-                }
-                save_p_values[14 + i].push_back(p_values[i]);
-                test_success[14 + i] += compare_p_value(p_values[i]);
-                i++;
-            }
-        } catch (const std::runtime_error &e) {
-            test_errors[13].push_back(num_test + e.what());
-            for (size_t i = 0; i < 18; ++i) {
-                save_p_values[14 + i].push_back(0.0);
-            }
+    for (size_t i = 0; i < test_errors.size(); ++i) {
+        for (const auto &[number, message] : other.test_errors[i]) {
+            test_errors[i].emplace_back(test_count + number, message);
         }
     }
+    test_count += other.test_count;
+}
 
-    {
-        try {
-            std::vector<std::double_t> p_values = nist::random_excursions_variant(bytes);
-            assert(p_values.size() == 18);
-            for (int s = -9, i = 0; s <= 9; ++s) {
-                if (s == 0) {
-                    continue;
-                }
-                if (print_p_values) {
-                    std::cout << test_names[22 + i] << ": p-value = " << p_values[i] << "\n";
-                }
-                save_p_values[22 + i].push_back(p_values[i]);
-                test_success[22 + i] += compare_p_value(p_values[i]);
-                i++;
-            }
-        } catch (const std::runtime_error &e) {
-            test_errors[14].push_back(num_test + e.what());
-            for (size_t i = 0; i < 18; ++i) {
-                save_p_values[22 + i].push_back(0.0);
-            }
-        }
-    }
+bool NistTest::operator==(const NistTest &other) const {
+    return StatisticalTest::operator==(other) && test_names == other.test_names &&
+           test_success == other.test_success && save_p_values == other.save_p_values &&
+           test_errors == other.test_errors;
 }
 
 void NistTest::print_statistics(const std::string &generator_name) const {
@@ -250,7 +243,7 @@ void NistTest::print_statistics(const std::string &generator_name) const {
     std::stringstream result;
     result << "Nist test for " << generator_name << " pass value: [" << pass_value_min << ";" << pass_value_max << "]"
            << std::endl;
-    for (size_t i = 0; i < 40; ++i) {
+    for (size_t i = 0; i < test_names.size(); ++i) {
         // pass test
         std::double_t p = static_cast<std::double_t>(test_success[i]) / static_cast<std::double_t>(test_count);
         bool answer_test = pass_value_min <= p && p <= pass_value_max;
@@ -297,8 +290,8 @@ void NistTest::print_statistics(const std::string &generator_name) const {
         if (!test_errors[i].empty()) {
             std::stringstream path;
             path << path_directory.str() << "/" << test_names_error[i] << "_errors.txt";
-            for (const auto &e : test_errors[i]) {
-                utils::save_string_to_file(path.str(), e + '\n', true);
+            for (const auto &[number, message] : test_errors[i]) {
+                utils::save_string_to_file(path.str(), std::to_string(number) + ". " + message + '\n', true);
             }
         }
     }
@@ -1,8 +1,12 @@
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <cmath>
 #include <complex>
+#include <cstring>
 #include <iostream>
 #include <map>
+#include <mutex>
 #include <stdexcept>
 #include <unordered_map>
 #include <utility>
@@ -11,21 +15,21 @@
 #include <boost/math/special_functions/gamma.hpp>
 #include <boost/math/special_functions/hypergeometric_1F1.hpp>
 
+#include "metrics/berlekamp_massey.hpp"
 #include "metrics/binary_matrix.hpp"
+#include "metrics/fft.hpp"
 #include "metrics/nist_tests.hpp"
+#include "metrics/pattern_counts.hpp"
 
 constexpr std::double_t alpha = 0.01;
 
 std::double_t nist::frequency_test(const utils::seq_bytes &bytes) {
-    size_t length_bytes = bytes.size();
-    std::int64_t sum = 0;
-    for (const auto &byte : bytes) {
-        if (byte) {
-            sum++;
-        } else {
-            sum--;
-        }
-    }
+    return nist::frequency_test(utils::SequenceAnalysis(bytes));
+}
+
+std::double_t nist::frequency_test(const utils::SequenceAnalysis &analysis) {
+    size_t length_bytes = analysis.size();
+    std::int64_t sum = 2 * static_cast<std::int64_t>(analysis.ones()) - static_cast<std::int64_t>(length_bytes);
     std::double_t s_obs = std::abs(sum) / std::sqrt(length_bytes);
     return boost::math::erfc(s_obs / std::sqrt(2));
 }
@@ -37,23 +41,22 @@ bool nist::check_frequency_test(const utils::seq_bytes &bytes) {
 std::double_t nist::frequency_block_test(const utils::seq_bytes &bytes, size_t m) {
     size_t length_bytes = bytes.size();
     size_t count_block = length_bytes / m;
-    std::vector<std::double_t> pi;
-    pi.resize(count_block);
-    for (size_t i = 0; i < count_block; ++i) {
-        size_t sum = 0;
-        size_t left_border = i * m;
-        size_t right_border = left_border + m;
-        for (size_t j = left_border; j < right_border; ++j) {
-            sum += bytes[j];
+    // 4 * m * (pi - 0.5)^2 = (2 * ones - m)^2 / m, so the sum over blocks is an exact integer whatever the threads
+    std::atomic<std::uint64_t> sum = 0;
+    utils::parallel_for(count_block, [&](size_t first, size_t last) {
+        std::uint64_t local = 0;
+        for (size_t i = first; i < last; ++i) {
+            const unsigned char *block = bytes.data() + i * m;
+            std::int64_t ones = 0;
+            for (size_t j = 0; j < m; ++j) {
+                ones += block[j];
+            }
+            std::int64_t deviation = 2 * ones - static_cast<std::int64_t>(m);
+            local += static_cast<std::uint64_t>(deviation * deviation);
         }
-        pi[i] = static_cast<std::double_t>(sum) / m;
-    }
-    std::double_t kappa = 4 * m;
-    std::double_t sum = 0;
-    for (const auto &p : pi) {
-        sum += (p - 0.5) * (p - 0.5);
-    }
-    kappa *= sum;
+        sum += local;
+    });
+    std::double_t kappa = static_cast<std::double_t>(sum.load()) / m;
     return boost::math::gamma_q(static_cast<std::double_t>(count_block) / 2.0, kappa / 2.0);
 }
 
@@ -62,14 +65,13 @@ bool nist::check_frequency_block_test(const utils::seq_bytes &bytes, size_t m) {
 }
 
 std::double_t nist::runs_test(const utils::seq_bytes &bytes) {
+    return nist::runs_test(utils::SequenceAnalysis(bytes));
+}
+
+std::double_t nist::runs_test(const utils::SequenceAnalysis &analysis) {
+    const utils::seq_bytes &bytes = analysis.bytes();
     size_t length_bytes = bytes.size();
-    std::double_t pi = 0;
-    for (const auto &byte : bytes) {
-        if (byte) {
-            ++pi;
-        }
-    }
-    pi /= length_bytes;
+    std::double_t pi = static_cast<std::double_t>(analysis.ones()) / length_bytes;
     size_t v = 1;
     for (size_t i = 0; i < length_bytes - 1; ++i) {
         if (bytes[i] != bytes[i + 1]) {
@@ -105,18 +107,22 @@ std::double_t nist::longest_run_of_ones(const utils::seq_bytes &bytes) {
     std::vector<std::uint16_t> &bounds = V[size_block];
     v.resize(bounds[1] - bounds[0] + 1);
     size_t count_block = length_bytes / size_block;
-    for (size_t i = 0; i < count_block; ++i) {
-        size_t left_border = i * size_block;
-        size_t right_border = left_border + size_block;
-        size_t max_run = utils::get_max_run(bytes, left_border, right_border);
-        if (max_run <= bounds[0]) {
-            v.front()++;
-        } else if (max_run >= bounds[1]) {
-            v.back()++;
-        } else {
-            v[max_run - bounds[0]]++;
+    std::mutex v_mutex;
+    utils::parallel_for(count_block, [&](size_t first, size_t last) {
+        std::vector<size_t> local(v.size(), 0);
+        for (size_t i = first; i < last; ++i) {
+            size_t left_border = i * size_block;
+            size_t right_border = left_border + size_block;
+            size_t max_run = utils::get_max_run(bytes, left_border, right_border);
+            size_t bin = std::clamp<size_t>(max_run, bounds[0], bounds[1]) - bounds[0];
+            local[bin]++;
         }
-    }
+        // Integer counts, so the order of the reduction does not change the result
+        std::lock_guard<std::mutex> lock(v_mutex);
+        for (size_t i = 0; i < v.size(); ++i) {
+            v[i] += local[i];
+        }
+    });
     std::double_t kappa = 0;
     size_t k = K[size_block];
     std::vector<std::double_t> pi = PI[{k, size_block}];
@@ -136,31 +142,25 @@ std::double_t nist::binary_matrix_rank(const utils::seq_bytes &bytes, size_t M,
         throw std::runtime_error("BINARY MATRIX RANK TEST: M != Q");
     }
     size_t N = bytes.size() / (M * Q);
-    std::vector<BinaryMatrix> binary_matrixes(N);
-    size_t index = 0;
-    for (size_t i = 0; i < N; ++i) {
-        utils::seq_bytes temp(M * Q);
-        for (size_t j = 0; j < M * Q; ++j) {
-            temp[j] = bytes[index];
-            index++;
-        }
-        binary_matrixes[i] = BinaryMatrix(temp, M);
-    }
-    std::vector<size_t> F(3, 0);
-    for (size_t i = 0; i < N; ++i) {
-        size_t rank_matrix = binary_matrixes[i].compute_rank();
-        if (rank_matrix == M) {
-            F[0]++;
-        } else if (rank_matrix == (M - 1)) {
-            F[1]++;
-        } else {
-            F[2]++;
+    // Numbers of matrices of full rank, rank M - 1 and lower rank
+    std::atomic<size_t> full = 0;
+    std::atomic<size_t> deficient = 0;
+    std::atomic<size_t> lower = 0;
+    utils::parallel_for(N, [&](size_t first, size_t last) {
+        size_t local[3] = {0, 0, 0};
+        for (size_t i = first; i < last; ++i) {
+            auto matrix = bytes.begin() + i * M * Q;
+            size_t rank_matrix = BinaryMatrix(utils::seq_bytes(matrix, matrix + M * Q), M).compute_rank();
+            local[rank_matrix == M ? 0 : rank_matrix == M - 1 ? 1 : 2]++;
         }
-    }
+        full += local[0];
+        deficient += local[1];
+        lower += local[2];
+    });
     std::double_t a = 0.288788 * N;
     std::double_t b = 0.577576 * N;
     std::double_t c = 0.133636 * N;
-    std::double_t kappa = std::pow(F[0] - a, 2) / a + std::pow(F[1] - b, 2) / b + std::pow(F[2] - c, 2) / c;
+    std::double_t kappa = std::pow(full - a, 2) / a + std::pow(deficient - b, 2) / b + std::pow(lower - c, 2) / c;
     std::double_t result = std::exp(-kappa / 2);
     return result;
 }
@@ -169,77 +169,63 @@ bool nist::check_binary_matrix_rank(const utils::seq_bytes &bytes, size_t M, siz
     return nist::binary_matrix_rank(bytes, M, Q) >= alpha;
 }
 
-std::vector<short> normalized(const utils::seq_bytes &bytes) {
-    size_t size = bytes.size();
-    std::vector<short> x(size);
-#pragma omp simd
-    for (size_t i = 0; i < size; ++i) {
-        x[i] = 2 * bytes[i] - 1;
-    }
-    return x;
-}
-
-std::double_t nist::discrete_fourier_transform(const utils::seq_bytes &bytes) {
+std::double_t nist::discrete_fourier_transform(const utils::seq_bytes &bytes, utils::FFTPrecision precision) {
     size_t size = bytes.size();
-    std::vector<short> x = normalized(bytes);
-    std::vector<std::complex<std::double_t>> X;
-    if ((size & (size - 1)) == 0) {
-        X = utils::FFT(x); // more fast for power of two
-    } else {
-        X = utils::DFT(x);
-    }
-    std::vector<std::double_t> M(size);
-    for (size_t i = 0; i < size; ++i) {
-        M[i] = std::abs(X[i]);
-    }
     std::double_t T = std::sqrt(std::log(1 / 0.05) * size);
     std::double_t N_0 = 0.95 * size / 2;
     std::double_t N_1 = 0;
-    for (size_t i = 0; i < size / 2; ++i) {
-        if (M[i] < T) {
-            N_1++;
-        }
+    if (!utils::RealFFTPlan<std::double_t>::supports(size)) {
+        throw std::runtime_error("Discrete Fourier transform test requires a non-empty sequence");
+    }
+    if (precision == utils::FFTPrecision::Float) {
+        N_1 = utils::RealFFTPlan<std::float_t>::get(size)->count_below(bytes, static_cast<std::float_t>(T));
+    } else {
+        N_1 = utils::RealFFTPlan<std::double_t>::get(size)->count_below(bytes, T);
     }
     std::double_t d = std::abs((N_1 - N_0) / std::sqrt(size * 0.95 * 0.05 / 4));
     return boost::math::erfc(d / std::sqrt(2));
 }
 
-bool nist::check_discrete_fourier_transform(const utils::seq_bytes &bytes) {
-    return nist::discrete_fourier_transform(bytes) >= alpha;
-}
-
-std::double_t nist::non_overlapping_template_matching(const utils::seq_bytes &bytes, const utils::seq_bytes &template_,
-                                                      size_t N) {
-    size_t n = bytes.size();
-    size_t m = template_.size();
-    size_t M = n / N;
-    std::vector<utils::seq_bytes> blocks(N);
-    for (size_t i = 0; i < N; ++i) {
-        for (size_t j = i * M; j < (i + 1) * M; ++j) {
-            blocks[i].push_back(bytes[j]);
-        }
-    }
-    std::vector<size_t> W(N, 0);
-    for (size_t i = 0; i < N; ++i) {
-        size_t index = 0;
-        auto &current_block = blocks[i];
-        while (index <= M - m) {
-            bool match = true;
-            size_t temp = index;
-            for (size_t j = 0; j < m; ++j) {
-                if (current_block[temp] != template_[j]) {
-                    match = false;
-                    index++;
-                    break;
+bool nist::check_discrete_fourier_transform(const utils::seq_bytes &bytes, utils::FFTPrecision precision) {
+    return nist::discrete_fourier_transform(bytes, precision) >= alpha;
+}
+
+namespace {
+
+// Matches of templates in each of the N blocks: a rolling m-bit window is compared with the templates through
+// lookup(window), which returns the template index or templates if nothing matches. After a match of template t
+// the next match of t may start only m bits later, so every template keeps the first start it can match at.
+// Result W[t * N + i] is the number of matches of template t in block i
+template <typename Lookup>
+std::vector<size_t> non_overlapping_matches(const utils::seq_bytes &bytes, size_t m, size_t N, size_t templates,
+                                            Lookup lookup) {
+    size_t M = bytes.size() / N;
+    std::vector<size_t> W(templates * N, 0);
+    const std::uint64_t mask = m == 64 ? ~std::uint64_t(0) : (std::uint64_t(1) << m) - 1;
+    utils::parallel_for(N, [&](size_t first, size_t last) {
+        std::vector<size_t> next_start(templates);
+        for (size_t i = first; i < last; ++i) {
+            std::fill(next_start.begin(), next_start.end(), 0);
+            const unsigned char *block = bytes.data() + i * M;
+            std::uint64_t window = 0;
+            for (size_t j = 0; j < M; ++j) {
+                window = ((window << 1) | block[j]) & mask;
+                if (j + 1 < m) {
+                    continue;
+                }
+                size_t t = lookup(window);
+                size_t start = j + 1 - m;
+                if (t < templates && start >= next_start[t]) {
+                    W[t * N + i]++;
+                    next_start[t] = start + m;
                 }
-                temp++;
-            }
-            if (match) {
-                W[i]++;
-                index += m;
             }
         }
-    }
+    });
+    return W;
+}
+
+std::double_t non_overlapping_p_value(const size_t *W, size_t N, size_t M, size_t m) {
     std::double_t pow2 = 1 << m;
     std::double_t a = (M - m + 1) / pow2;
     std::double_t b = M * (1 / pow2 - (2 * m - 1) / (pow2 * pow2));
@@ -251,6 +237,76 @@ std::double_t nist::non_overlapping_template_matching(const utils::seq_bytes &by
     return boost::math::gamma_q(static_cast<std::double_t>(N) / 2.0, kappa / 2.0);
 }
 
+std::uint64_t template_value(const utils::seq_bytes &template_) {
+    std::uint64_t value = 0;
+    for (unsigned char bit : template_) {
+        value = (value << 1) | bit;
+    }
+    return value;
+}
+
+} // namespace
+
+std::double_t nist::non_overlapping_template_matching(const utils::seq_bytes &bytes, const utils::seq_bytes &template_,
+                                                      size_t N) {
+    size_t m = template_.size();
+    if (m == 0 || m > 64) {
+        throw std::runtime_error("NON-OVERLAPPING TEMPLATE MATCHING TEST: TEMPLATE LENGTH IS OUT OF RANGE");
+    }
+    std::uint64_t value = template_value(template_);
+    std::vector<size_t> W = non_overlapping_matches(bytes, m, N, 1, [value](std::uint64_t window) -> size_t {
+        return window == value ? 0 : 1;
+    });
+    return non_overlapping_p_value(W.data(), N, bytes.size() / N, m);
+}
+
+std::vector<std::double_t> nist::non_overlapping_template_matching(const utils::seq_bytes &bytes,
+                                                                   const std::vector<utils::seq_bytes> &templates,
+                                                                   size_t N) {
+    if (templates.empty()) {
+        return {};
+    }
+    size_t m = templates[0].size();
+    if (m == 0 || m > 16) {
+        throw std::runtime_error("NON-OVERLAPPING TEMPLATE MATCHING TEST: TEMPLATE LENGTH IS OUT OF RANGE");
+    }
+    // Window value -> template index, templates.size() for windows that match no template
+    std::vector<std::uint16_t> table(size_t(1) << m, static_cast<std::uint16_t>(templates.size()));
+    for (size_t t = 0; t < templates.size(); ++t) {
+        if (templates[t].size() != m) {
+            throw std::runtime_error("NON-OVERLAPPING TEMPLATE MATCHING TEST: TEMPLATES HAVE DIFFERENT LENGTHS");
+        }
+        table[template_value(templates[t])] = static_cast<std::uint16_t>(t);
+    }
+    std::vector<size_t> W = non_overlapping_matches(bytes, m, N, templates.size(), [&table](std::uint64_t window) {
+        return static_cast<size_t>(table[window]);
+    });
+    std::vector<std::double_t> p_values(templates.size());
+    for (size_t t = 0; t < templates.size(); ++t) {
+        p_values[t] = non_overlapping_p_value(W.data() + t * N, N, bytes.size() / N, m);
+    }
+    return p_values;
+}
+
+std::vector<utils::seq_bytes> nist::aperiodic_templates(size_t m) {
+    // A template is aperiodic when no proper prefix of it is also its suffix, so its matches can not overlap
+    std::vector<utils::seq_bytes> templates;
+    for (std::uint64_t value = 0; value < (std::uint64_t(1) << m); ++value) {
+        utils::seq_bytes template_(m);
+        for (size_t j = 0; j < m; ++j) {
+            template_[j] = (value >> (m - 1 - j)) & 1;
+        }
+        bool aperiodic = true;
+        for (size_t shift = 1; shift < m && aperiodic; ++shift) {
+            aperiodic = !std::equal(template_.begin(), template_.end() - shift, template_.begin() + shift);
+        }
+        if (aperiodic) {
+            templates.push_back(std::move(template_));
+        }
+    }
+    return templates;
+}
+
 bool nist::check_non_overlapping_template_matching(const utils::seq_bytes &bytes, const utils::seq_bytes &template_,
                                                    size_t N) {
     return nist::non_overlapping_template_matching(bytes, template_, N) >= alpha;
@@ -271,37 +327,37 @@ std::double_t nist::overlapping_template_matching(const utils::seq_bytes &bytes,
                                                   size_t M, size_t N, size_t K, bool test) {
     size_t n = bytes.size();
     size_t m = template_.size();
-    std::vector<utils::seq_bytes> blocks(N);
-    for (size_t i = 0; i < N; ++i) {
-        for (size_t j = i * M; j < (i + 1) * M; ++j) {
-            blocks[i].push_back(bytes[j]);
-        }
+    if (m == 0 || m > 64) {
+        throw std::runtime_error("OVERLAPPING TEMPLATE MATCHING TEST: TEMPLATE LENGTH IS OUT OF RANGE");
     }
-    std::vector<size_t> v(6, 0);
-    for (size_t i = 0; i < N; ++i) {
-        size_t W = 0;
-        auto &current_block = blocks[i];
-        for (size_t index = 0; index < M; index++) {
-            if (index + m > M) {
-                break;
-            }
-            bool match = true;
-            size_t temp = index;
-            for (size_t j = 0; j < m; ++j, ++temp) {
-                if (current_block[temp] != template_[j]) {
-                    match = false;
-                    break;
-                }
-            }
-            if (match) {
-                W++;
+    if (M == 0) {
+        throw std::runtime_error("OVERLAPPING TEMPLATE MATCHING TEST: BLOCK LENGTH IS ZERO");
+    }
+    if (n / M == 0) {
+        throw std::runtime_error("OVERLAPPING TEMPLATE MATCHING TEST: SEQUENCE IS SHORTER THAN ONE BLOCK");
+    }
+    // N = 0 takes all complete blocks of the sequence, and N is never allowed past its end
+    if (N == 0 || N > n / M) {
+        N = n / M;
+    }
+    const std::uint64_t value = template_value(template_);
+    const std::uint64_t mask = m == 64 ? ~std::uint64_t(0) : (std::uint64_t(1) << m) - 1;
+    std::vector<size_t> W(N, 0);
+    utils::parallel_for(N, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i) {
+            const unsigned char *block = bytes.data() + i * M;
+            std::uint64_t window = 0;
+            size_t matches = 0;
+            for (size_t j = 0; j < M; ++j) {
+                window = ((window << 1) | block[j]) & mask;
+                matches += j + 1 >= m && window == value;
             }
+            W[i] = matches;
         }
-        if (W <= 4) {
-            v[W]++;
-        } else {
-            v[K]++;
-        }
+    });
+    std::vector<size_t> v(K + 1, 0);
+    for (size_t i = 0; i < N; ++i) {
+        v[std::min(W[i], K)]++;
     }
     std::vector<std::double_t> pi(K + 1, 0);
     if (test) {
@@ -332,13 +388,24 @@ bool nist::check_overlapping_template_matching(const utils::seq_bytes &bytes, co
     return nist::overlapping_template_matching(bytes, template_, M, N, K, test) >= alpha;
 }
 
+namespace {
+
+// Number of chunks the test blocks of the universal test are split into
+constexpr size_t universal_chunks = 64;
+
+} // namespace
+
 std::double_t nist::universal(const utils::seq_bytes &bytes) {
+    return nist::universal(utils::SequenceAnalysis(bytes));
+}
+
+std::double_t nist::universal(const utils::SequenceAnalysis &analysis) {
     std::vector<std::double_t> expected_value = {0,         0,         0,         0,         0,         0,
                                                  5.2177052, 6.1962507, 7.1836656, 8.1764248, 9.1723243, 10.170032,
                                                  11.168765, 12.168070, 13.167693, 14.167488, 15.167379};
     std::vector<std::double_t> variance = {0,     0,     0,     0,     0,     0,     2.954, 3.125, 3.238,
                                            3.311, 3.356, 3.384, 3.401, 3.410, 3.416, 3.419, 3.421};
-    size_t n = bytes.size();
+    size_t n = analysis.size();
     size_t L = 5;
     if (n >= 387840) {
         L = 6;
@@ -379,22 +446,61 @@ std::double_t nist::universal(const utils::seq_bytes &bytes) {
         throw std::runtime_error("UNIVERSAL STATISTICAL TEST: L IS OUT OF RANGE");
     }
     size_t K = n / L - Q;
+    const std::vector<std::uint64_t> &words = analysis.packed_bits();
+    // Block i (1-based) is the L-bit number starting at bit (i - 1) * L
+    auto block = [&words, L](size_t i) -> size_t { return utils::packed_window(words, (i - 1) * L, L); };
+    // log2 of the distances between repeated blocks, which are about 2^L on average
+    std::vector<std::double_t> log2_table(16 * p);
+    for (size_t d = 1; d < log2_table.size(); ++d) {
+        log2_table[d] = std::log(d) / std::log(2);
+    }
+    auto log2_distance = [&log2_table](size_t d) {
+        return d < log2_table.size() ? log2_table[d] : std::log(d) / std::log(2);
+    };
     std::vector<size_t> T(p, 0);
     for (size_t i = 1; i <= Q; ++i) {
-        size_t dec_rep = 0;
-        for (size_t j = 0; j < L; ++j) {
-            dec_rep += bytes[(i - 1) * L + j] * (1 << (L - j - 1));
+        T[block(i)] = i;
+    }
+    // The test blocks are split into a fixed number of chunks, so the sum does not depend on the number of threads.
+    // A chunk does not know the occurrences before it, so it stores the first and the last occurrence of every
+    // value as offsets from its start (0 if the value does not occur), and the distances to the first occurrences
+    // are added afterwards, going through the chunks in order
+    const size_t chunks = std::min<size_t>(universal_chunks, K);
+    std::vector<std::uint32_t> first(chunks * p, 0);
+    std::vector<std::uint32_t> last(chunks * p, 0);
+    std::vector<std::double_t> chunk_sum(chunks, 0);
+    utils::parallel_for(chunks, [&](size_t first_chunk, size_t last_chunk) {
+        for (size_t c = first_chunk; c < last_chunk; ++c) {
+            size_t begin = Q + 1 + K * c / chunks;
+            size_t end = Q + 1 + K * (c + 1) / chunks;
+            std::uint32_t *chunk_first = first.data() + c * p;
+            std::uint32_t *chunk_last = last.data() + c * p;
+            std::double_t sum = 0;
+            for (size_t i = begin; i < end; ++i) {
+                size_t value = block(i);
+                std::uint32_t offset = static_cast<std::uint32_t>(i - begin + 1);
+                if (chunk_last[value] == 0) {
+                    chunk_first[value] = offset;
+                } else {
+                    sum += log2_distance(offset - chunk_last[value]);
+                }
+                chunk_last[value] = offset;
+            }
+            chunk_sum[c] = sum;
         }
-        T[dec_rep] = i;
-    }
+    });
     std::double_t sum = 0;
-    for (size_t i = Q + 1; i <= Q + K; ++i) {
-        size_t dec_rep = 0;
-        for (size_t j = 0; j < L; ++j) {
-            dec_rep += bytes[(i - 1) * L + j] * (1 << (L - j - 1));
+    for (size_t c = 0; c < chunks; ++c) {
+        size_t begin = Q + 1 + K * c / chunks;
+        const std::uint32_t *chunk_first = first.data() + c * p;
+        const std::uint32_t *chunk_last = last.data() + c * p;
+        sum += chunk_sum[c];
+        for (size_t value = 0; value < p; ++value) {
+            if (chunk_first[value] != 0) {
+                sum += log2_distance(begin - 1 + chunk_first[value] - T[value]);
+                T[value] = begin - 1 + chunk_last[value];
+            }
         }
-        sum += std::log(i - T[dec_rep]) / std::log(2);
-        T[dec_rep] = i;
     }
     std::double_t f_n = sum / (std::double_t)K;
     std::double_t c = 0.7 - 0.8 / L + (4 + 32.0 / (std::double_t)L) * std::pow(K, -3.0 / (std::double_t)L) / 15;
@@ -406,7 +512,7 @@ bool nist::check_universal(const utils::seq_bytes &bytes) {
     return nist::universal(bytes) >= alpha;
 }
 
-std::double_t nist::linear_complexity(const utils::seq_bytes &bytes, size_t M) {
+std::double_t nist::linear_complexity(const utils::seq_bytes &bytes, size_t M, nist::LinearComplexityEngine engine) {
     std::vector<std::double_t> pi = {0.01047, 0.03125, 0.12500, 0.50000, 0.25000, 0.06250, 0.020833};
     size_t n = bytes.size();
     size_t K = 6;
@@ -415,51 +521,11 @@ std::double_t nist::linear_complexity(const utils::seq_bytes &bytes, size_t M) {
         throw std::runtime_error("LINEAR COMPLEXITY TEST: ERROR: N < 200");
     }
     std::vector<size_t> v(K + 1, 0);
-    utils::seq_bytes B_(M, 0);
-    utils::seq_bytes C(M, 0);
-    utils::seq_bytes P(M, 0);
-    utils::seq_bytes T(M, 0);
+    std::vector<size_t> complexity = engine == nist::LinearComplexityEngine::BitSliced
+                                         ? utils::berlekamp_massey_blocks_bitsliced(bytes, M, N)
+                                         : utils::berlekamp_massey_blocks(bytes, M, N);
     for (size_t i = 0; i < N; ++i) {
-        for (size_t j = 0; j < M; ++j) {
-            B_[j] = 0;
-            C[j] = 0;
-            P[j] = 0;
-            T[j] = 0;
-        }
-        C[0] = 1;
-        B_[0] = 1;
-        int L = 0;
-        int m = -1;
-        int N_ = 0;
-        while (N_ < M) {
-            int d = bytes[i * M + N_];
-            for (size_t j = 1; j <= L; ++j) {
-                d += C[j] * bytes[i * M + N_ - j];
-            }
-            d %= 2;
-            if (d == 1) {
-                for (size_t j = 0; j < M; ++j) {
-                    T[j] = C[j];
-                    P[j] = 0;
-                }
-                for (size_t j = 0; j < M; ++j) {
-                    if (B_[j] == 1) {
-                        P[j + N_ - m] = 1;
-                    }
-                }
-                for (size_t j = 0; j < M; ++j) {
-                    C[j] = (C[j] + P[j]) % 2;
-                }
-                if (L <= N_ / 2) {
-                    L = N_ + 1 - L;
-                    m = N_;
-                    for (size_t j = 0; j < M; ++j) {
-                        B_[j] = T[j];
-                    }
-                }
-            }
-            N_++;
-        }
+        std::double_t L = static_cast<std::double_t>(complexity[i]);
         int sign = (M + 1) % 2 == 0 ? -1 : 1;
         std::double_t mean = M / 2.0 + (9.0 + sign) / 36.0 - (M / 3.0 + 2.0 / 9.0) / std::pow(2, M);
         std::double_t T_ = sign * (L - mean) + 2.0 / 9.0;
@@ -486,41 +552,28 @@ std::double_t nist::linear_complexity(const utils::seq_bytes &bytes, size_t M) {
     return boost::math::gamma_q(K / 2.0, kappa / 2.0);
 }
 
-bool nist::check_linear_complexity(const utils::seq_bytes &bytes, size_t M) {
-    return nist::linear_complexity(bytes, M) >= alpha;
+bool nist::check_linear_complexity(const utils::seq_bytes &bytes, size_t M, nist::LinearComplexityEngine engine) {
+    return nist::linear_complexity(bytes, M, engine) >= alpha;
 }
 
-std::double_t psi(const utils::seq_bytes &bytes, size_t m) {
-    if (m == 0) {
-        return 0;
-    }
-    size_t n = bytes.size();
-
-    std::vector<size_t> vi((1 << (m + 1)) - 1, 0);
-    for (size_t i = 0; i < n; ++i) {
-        size_t k = 1;
-        for (size_t j = 0; j < m; ++j) {
-            if (bytes[(i + j) % n] == 0) {
-                k *= 2;
-            } else if (bytes[(i + j) % n] == 1) {
-                k = 2 * k + 1;
-            }
-        }
-        vi[k - 1]++;
-    }
-
+// psi^2_m statistic from the counts of all m-bit patterns
+std::double_t psi(const std::vector<size_t> &counts, size_t n) {
     std::double_t result = 0;
-    std::uint64_t index = 1 << m;
-    for (std::uint64_t i = index - 1; i < index * 2 - 1; ++i) {
-        result += std::pow(vi[i], 2);
+    for (size_t count : counts) {
+        result += std::pow(count, 2);
     }
-    return result * index / n - n;
+    return result * counts.size() / n - n;
 }
 
 std::pair<std::double_t, std::double_t> nist::serial_complexity(const utils::seq_bytes &bytes, size_t m) {
-    std::double_t psi0 = psi(bytes, m);
-    std::double_t psi1 = psi(bytes, m - 1);
-    std::double_t psi2 = psi(bytes, m - 2);
+    return nist::serial_complexity(utils::SequenceAnalysis(bytes), m);
+}
+
+std::pair<std::double_t, std::double_t> nist::serial_complexity(const utils::SequenceAnalysis &analysis, size_t m) {
+    size_t n = analysis.size();
+    std::double_t psi0 = psi(analysis.pattern_counts(m), n);
+    std::double_t psi1 = psi(analysis.pattern_counts(m - 1), n);
+    std::double_t psi2 = psi(analysis.pattern_counts(m - 2), n);
     std::double_t del1 = psi0 - psi1;
     std::double_t del2 = psi0 - 2 * psi1 + psi2;
     std::double_t arg = 1 << (m - 2);
@@ -532,38 +585,26 @@ bool nist::check_serial_complexity(const utils::seq_bytes &bytes, size_t m) {
     return p_value.first >= alpha && p_value.second >= alpha;
 }
 
-std::double_t ap_en(const utils::seq_bytes &bytes, size_t block_size) {
-    if (block_size == 0) {
-        return 0;
-    }
-    size_t n = bytes.size();
-    size_t pow_len = (1 << (block_size + 1)) - 1;
-    std::vector<size_t> vi(pow_len, 0);
-    for (size_t i = 0; i < n; ++i) {
-        int k = 1;
-        for (size_t j = 0; j < block_size; ++j) {
-            k <<= 1;
-            if (bytes[(i + j) % n] == 1) {
-                k++;
-            }
-        }
-        vi[k - 1]++;
-    }
+// phi_m statistic from the counts of all m-bit patterns
+std::double_t ap_en(const std::vector<size_t> &counts, size_t n) {
     std::double_t sum = 0;
-    size_t right_bound = 1 << block_size;
-    size_t index = right_bound - 1;
-    for (size_t i = 0; i < right_bound; ++i, index++) {
-        if (vi[index] > 0) {
-            sum += vi[index] * std::log(vi[index] * 1.0 / n);
+    for (size_t count : counts) {
+        if (count > 0) {
+            sum += count * std::log(count * 1.0 / n);
         }
     }
     return sum / n;
 }
 
 std::double_t nist::approximate_entropy(const utils::seq_bytes &bytes, size_t m) {
-    size_t n = bytes.size();
-    std::double_t psi0 = ap_en(bytes, m);
-    std::double_t psi1 = ap_en(bytes, m + 1);
+    return nist::approximate_entropy(utils::SequenceAnalysis(bytes), m);
+}
+
+std::double_t nist::approximate_entropy(const utils::SequenceAnalysis &analysis, size_t m) {
+    size_t n = analysis.size();
+    // The higher order first, so that order m is marginalized from it
+    std::double_t psi1 = ap_en(analysis.pattern_counts(m + 1), n);
+    std::double_t psi0 = ap_en(analysis.pattern_counts(m), n);
     std::double_t ApEn = psi0 - psi1;
     std::double_t kappa = 2 * n * (std::log(2) - ApEn);
     return boost::math::gamma_q(1 << (m - 1), kappa / 2.0);
@@ -573,28 +614,81 @@ bool nist::check_approximate_entropy(const utils::seq_bytes &bytes, size_t m) {
     return nist::approximate_entropy(bytes, m) >= alpha;
 }
 
-std::vector<int> partial_sums(const std::vector<short> &x,
-                              nist::CumulativeSumsMode mode = nist::CumulativeSumsMode::Forward) {
-    size_t n = x.size();
-    std::vector<int> S(n + 1, 0);
-    if (mode == nist::CumulativeSumsMode::Forward) {
-        for (size_t i = 1; i <= n; ++i) {
-            S[i] = S[i - 1] + x[i - 1];
+namespace {
+
+// Range of the partial sums S_0 = 0, S_1, ..., S_n of the +-1 sequence
+struct PartialSumsRange {
+    std::int64_t total = 0;
+    std::int64_t min = 0;
+    std::int64_t max = 0;
+
+    // Range of the concatenation of this part and the next one
+    PartialSumsRange then(const PartialSumsRange &next) const {
+        return {total + next.total, std::min(min, total + next.min), std::max(max, total + next.max)};
+    }
+};
+
+// Sum, minimal and maximal prefix sum of the 8 steps coded by a byte, its highest bit is the first step
+struct ByteSteps {
+    std::array<std::int8_t, 256> total;
+    std::array<std::int8_t, 256> min;
+    std::array<std::int8_t, 256> max;
+
+    ByteSteps() {
+        for (size_t value = 0; value < 256; ++value) {
+            std::int8_t sum = 0;
+            min[value] = 0;
+            max[value] = 0;
+            for (size_t bit = 8; bit-- > 0;) {
+                sum += (value >> bit) & 1 ? 1 : -1;
+                min[value] = std::min(min[value], sum);
+                max[value] = std::max(max[value], sum);
+            }
+            total[value] = sum;
         }
-    } else {
-        for (size_t i = 1; i <= n; ++i) {
-            S[i] = S[i - 1] + x[n - i];
+    }
+};
+
+// Steps of the cumulative sums in blocks of 8 input bytes, which are gathered into one byte by a multiplication and
+// applied through the ByteSteps tables. Chunks of the sequence run in parallel and their ranges are joined in order
+PartialSumsRange partial_sums_range(const utils::seq_bytes &bytes) {
+    static const ByteSteps steps;
+    constexpr size_t chunk_bytes = size_t(1) << 16;
+    const size_t n = bytes.size();
+    const size_t chunks = (n + chunk_bytes - 1) / chunk_bytes;
+    std::vector<PartialSumsRange> ranges(chunks);
+    utils::parallel_for(chunks, [&](size_t first_chunk, size_t last_chunk) {
+        for (size_t c = first_chunk; c < last_chunk; ++c) {
+            const size_t begin = c * chunk_bytes;
+            const size_t end = std::min(n, begin + chunk_bytes);
+            std::int64_t total = 0;
+            std::int64_t min = 0;
+            std::int64_t max = 0;
+            size_t i = begin;
+            for (; i + 8 <= end; i += 8) {
+                std::uint64_t group;
+                std::memcpy(&group, bytes.data() + i, sizeof(group));
+                const size_t value = (group * 0x8040201008040201ULL) >> 56;
+                min = std::min<std::int64_t>(min, total + steps.min[value]);
+                max = std::max<std::int64_t>(max, total + steps.max[value]);
+                total += steps.total[value];
+            }
+            for (; i < end; ++i) {
+                total += bytes[i] ? 1 : -1;
+                min = std::min(min, total);
+                max = std::max(max, total);
+            }
+            ranges[c] = {total, min, max};
         }
+    });
+    PartialSumsRange range;
+    for (const auto &chunk : ranges) {
+        range = range.then(chunk);
     }
-    return S;
+    return range;
 }
 
-std::double_t nist::cumulative_sums(const utils::seq_bytes &bytes, nist::CumulativeSumsMode mode) {
-    size_t n = bytes.size();
-    std::vector<short> x = normalized(bytes);
-    std::vector<int> S = partial_sums(x, mode);
-    int z =
-        std::abs(*std::max_element(S.begin(), S.end(), [](int lhs, int rhs) { return std::abs(lhs) < std::abs(rhs); }));
+std::double_t cumulative_sums_p_value(size_t n, int z) {
     std::double_t sum1 = 0;
     int left = (-(int)n / z + 1) / 4;
     int right = (n / z - 1) / 4;
@@ -612,11 +706,93 @@ std::double_t nist::cumulative_sums(const utils::seq_bytes &bytes, nist::Cumulat
     return 1.0 - sum1 + sum2;
 }
 
+} // namespace
+
+std::double_t nist::cumulative_sums(const utils::seq_bytes &bytes, nist::CumulativeSumsMode mode) {
+    auto [forward, reverse] = nist::cumulative_sums(bytes);
+    return mode == nist::CumulativeSumsMode::Forward ? forward : reverse;
+}
+
+std::pair<std::double_t, std::double_t> nist::cumulative_sums(const utils::seq_bytes &bytes) {
+    // The reverse partial sums are S_n - S_{n-k}, so both maxima of |S| follow from the range of the forward sums
+    PartialSumsRange range = partial_sums_range(bytes);
+    int z_forward = static_cast<int>(std::max(range.max, -range.min));
+    int z_reverse = static_cast<int>(std::max(range.total - range.min, range.max - range.total));
+    size_t n = bytes.size();
+    return {cumulative_sums_p_value(n, z_forward), cumulative_sums_p_value(n, z_reverse)};
+}
+
 bool nist::check_cumulative_sums(const utils::seq_bytes &bytes, nist::CumulativeSumsMode mode) {
     return nist::cumulative_sums(bytes, mode) >= alpha;
 }
 
-std::vector<std::double_t> nist::random_excursions(const utils::seq_bytes &bytes, bool check) {
+namespace {
+
+// Visit counts of the random walk S_0 = 0, S_1, ..., S_n, 0 split into J cycles between its zeros
+struct RandomExcursionsCounts {
+    size_t J = 0;
+    // cycles[c][i] is the number of cycles with min(c, 5) visits to the state i of -4, ..., -1, 1, ..., 4
+    std::array<std::array<size_t, 8>, 6> cycles{};
+    // Total number of visits to the states -9, ..., 9
+    std::array<size_t, 19> visits{};
+};
+
+// One walk over the sequence without storing the partial sums. A group of 8 steps that starts further than 17 from
+// zero can not reach any of the states -9, ..., 9, so it is applied at once through the ByteSteps tables
+RandomExcursionsCounts count_random_excursions(const utils::seq_bytes &bytes) {
+    static const ByteSteps steps;
+    RandomExcursionsCounts counts;
+    std::array<size_t, 8> cycle{};
+    auto close_cycle = [&counts, &cycle]() {
+        for (size_t i = 0; i < cycle.size(); ++i) {
+            counts.cycles[std::min<size_t>(cycle[i], 5)][i]++;
+            cycle[i] = 0;
+        }
+        counts.J++;
+    };
+    auto step = [&counts, &cycle, &close_cycle](std::int64_t S) {
+        if (S == 0) {
+            close_cycle();
+        } else if (S >= -9 && S <= 9) {
+            counts.visits[S + 9]++;
+            if (S >= -4 && S <= 4) {
+                cycle[S < 0 ? S + 4 : S + 3]++;
+            }
+        }
+    };
+    const size_t n = bytes.size();
+    std::int64_t S = 0;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        std::uint64_t group;
+        std::memcpy(&group, bytes.data() + i, sizeof(group));
+        const size_t value = (group * 0x8040201008040201ULL) >> 56;
+        if (S > 17 || S < -17) {
+            S += steps.total[value];
+            continue;
+        }
+        for (size_t bit = 8; bit-- > 0;) {
+            S += (value >> bit) & 1 ? 1 : -1;
+            step(S);
+        }
+    }
+    for (; i < n; ++i) {
+        S += bytes[i] ? 1 : -1;
+        step(S);
+    }
+    // The walk is closed by the appended S_{n+1} = 0
+    close_cycle();
+    return counts;
+}
+
+void check_cycles(size_t J, size_t n, const std::string &test_name) {
+    size_t constraint = static_cast<size_t>(std::max(0.005 * std::pow(n, 0.5), 500.0));
+    if (J < constraint) {
+        throw std::runtime_error(test_name + ": INSUFFICIENT NUMBER OF CYCLES " + std::to_string(J));
+    }
+}
+
+std::vector<std::double_t> random_excursions_p_values(const RandomExcursionsCounts &counts) {
     std::vector<int> state_x = {-4, -3, -2, -1, 1, 2, 3, 4};
     constexpr size_t count_state = 8;
     std::vector<std::vector<std::double_t>> pi = {
@@ -625,57 +801,42 @@ std::vector<std::double_t> nist::random_excursions(const utils::seq_bytes &bytes
         {0.7500000000, 0.06250000000, 0.04687500000, 0.03515625000, 0.02636718750, 0.0791015625},
         {0.8333333333, 0.02777777778, 0.02314814815, 0.01929012346, 0.01607510288, 0.0803755143},
         {0.8750000000, 0.01562500000, 0.01367187500, 0.01196289063, 0.01046752930, 0.0732727051}};
-    std::vector<short> x = normalized(bytes);
-    std::vector<int> S = partial_sums(x);
-    std::vector<int> S_ = S;
-    S_.push_back(0);
-    size_t J = std::count_if(std::next(S_.begin()), S_.end(), [](int element) { return element == 0; });
-    int constraint = (int)std::max(0.005 * std::pow(bytes.size(), 0.5), 500.0);
-    if (check && J < constraint) {
-        throw std::runtime_error("Random Excursions Variant: INSUFFICIENT NUMBER OF CYCLES " + std::to_string(J));
-    }
-    std::vector<std::vector<int>> cycles(J);
-    size_t index = 0;
-    cycles[index].push_back(0);
-    for (size_t i = 1; i < S_.size(); ++i) {
-        cycles[index].push_back(S_[i]);
-        if (S_[i] == 0) {
-            index++;
-            if (index < J) {
-                cycles[index].push_back(S_[i]);
-            }
-        }
-    }
-    std::vector<size_t> counter(count_state, 0);
-    std::vector<std::vector<size_t>> vi(6, std::vector<size_t>(8, 0));
-    for (const auto &cycle : cycles) {
-        for (size_t i = 0; i < count_state; ++i) {
-            counter[i] = 0;
-        }
-        for (size_t i = 0; i < count_state; ++i) {
-            int elem = state_x[i];
-            counter[i] = std::count_if(cycle.begin(), cycle.end(), [&elem](int element) { return element == elem; });
-        }
-        for (size_t i = 0; i < count_state; ++i) {
-            if (counter[i] >= 0 && counter[i] <= 4) {
-                vi[counter[i]][i]++;
-            } else {
-                vi[5][i]++;
-            }
-        }
-    }
+    const size_t J = counts.J;
     std::vector<std::double_t> p_values(count_state, 0);
     for (size_t i = 0; i < count_state; ++i) {
         int x = state_x[i];
         std::double_t sum = 0;
         for (size_t j = 0; j < 6; ++j) {
-            sum += (std::pow(vi[j][i] - J * pi[(int)std::abs(x)][j], 2) / (J * pi[(int)std::abs(x)][j]));
+            sum += (std::pow(counts.cycles[j][i] - J * pi[(int)std::abs(x)][j], 2) / (J * pi[(int)std::abs(x)][j]));
         }
         p_values[i] = boost::math::gamma_q(2.5, sum / 2.0);
     }
     return p_values;
 }
 
+std::vector<std::double_t> random_excursions_variant_p_values(const RandomExcursionsCounts &counts) {
+    const size_t J = counts.J;
+    std::vector<std::double_t> p_values;
+    for (int x = -9; x <= 9; ++x) {
+        if (x == 0) {
+            continue;
+        }
+        std::double_t count = counts.visits[x + 9];
+        p_values.push_back(boost::math::erfc(std::abs(count - J) / (std::sqrt(2 * J * (4 * std::abs(x) - 2)))));
+    }
+    return p_values;
+}
+
+} // namespace
+
+std::vector<std::double_t> nist::random_excursions(const utils::seq_bytes &bytes, bool check) {
+    RandomExcursionsCounts counts = count_random_excursions(bytes);
+    if (check) {
+        check_cycles(counts.J, bytes.size(), "Random Excursions");
+    }
+    return random_excursions_p_values(counts);
+}
+
 std::vector<bool> nist::check_random_excursions(const utils::seq_bytes &bytes, bool check) {
     std::vector<std::double_t> p_values = nist::random_excursions(bytes, check);
     std::vector<bool> results(p_values.size(), false);
@@ -686,26 +847,20 @@ std::vector<bool> nist::check_random_excursions(const utils::seq_bytes &bytes, b
 }
 
 std::vector<std::double_t> nist::random_excursions_variant(const utils::seq_bytes &bytes, bool check) {
-    std::vector<int> state_x = {-9, -8, -7, -6, -5, -4, -3, -2, -1, 1, 2, 3, 4, 5, 6, 7, 8, 9};
-    size_t count_state = 18;
-    std::vector<short> x = normalized(bytes);
-    std::vector<int> S = partial_sums(x);
-    std::vector<int> S_ = S;
-    S_.push_back(0);
-    size_t J = std::count_if(std::next(S_.begin()), S_.end(), [](int element) { return element == 0; });
-    int constraint = (int)std::max(0.005 * std::pow(bytes.size(), 0.5), 500.0);
-    if (check && J < constraint) {
-        throw std::runtime_error("Random Excursions Variant: INSUFFICIENT NUMBER OF CYCLES " + std::to_string(J));
+    RandomExcursionsCounts counts = count_random_excursions(bytes);
+    if (check) {
+        check_cycles(counts.J, bytes.size(), "Random Excursions Variant");
     }
+    return random_excursions_variant_p_values(counts);
+}
 
-    std::vector<std::double_t> p_values(count_state, 0);
-    for (size_t i = 0; i < count_state; ++i) {
-        int x = state_x[i];
-        std::double_t count = std::count_if(S_.begin(), S_.end(), [&x](int element) { return element == x; });
-        p_values[i] = boost::math::erfc(std::abs(count - J) / (std::sqrt(2 * J * (4 * std::abs(x) - 2))));
+std::pair<std::vector<std::double_t>, std::vector<std::double_t>>
+nist::random_excursions_and_variant(const utils::seq_bytes &bytes, bool check) {
+    RandomExcursionsCounts counts = count_random_excursions(bytes);
+    if (check) {
+        check_cycles(counts.J, bytes.size(), "Random Excursions");
     }
-
-    return p_values;
+    return {random_excursions_p_values(counts), random_excursions_variant_p_values(counts)};
 }
 
 std::vector<bool> nist::check_random_excursions_variant(const utils::seq_bytes &bytes, bool check) {
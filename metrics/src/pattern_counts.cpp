@@ -0,0 +1,42 @@
+#include "metrics/pattern_counts.hpp"
+
+namespace utils {
+
+std::vector<size_t> overlapping_pattern_counts(const seq_bytes &bytes, size_t m) {
+    std::vector<size_t> counts(size_t(1) << m, 0);
+    const size_t n = bytes.size();
+    if (n == 0) {
+        return counts;
+    }
+    if (m == 0) {
+        counts[0] = n;
+        return counts;
+    }
+    const size_t mask = counts.size() - 1;
+    // The window ending at bit j is updated with one shift, its first m - 1 bits are loaded once
+    size_t window = 0;
+    for (size_t j = 0; j + 1 < m; ++j) {
+        window = (window << 1) | bytes[j % n];
+    }
+    const size_t end = n + m - 1;
+    size_t j = m - 1;
+    for (; j < n; ++j) {
+        window = ((window << 1) | bytes[j]) & mask;
+        counts[window]++;
+    }
+    for (; j < end; ++j) {
+        window = ((window << 1) | bytes[(j - n) % n]) & mask;
+        counts[window]++;
+    }
+    return counts;
+}
+
+std::vector<size_t> marginalize_pattern_counts(const std::vector<size_t> &counts) {
+    std::vector<size_t> result(counts.size() / 2);
+    for (size_t v = 0; v < result.size(); ++v) {
+        result[v] = counts[2 * v] + counts[2 * v + 1];
+    }
+    return result;
+}
+
+} // namespace utils
@@ -0,0 +1,233 @@
+#include "metrics/point_grid.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+template <size_t Dims>
+double squared_distance(const std::array<double, Dims> &a, const std::array<double, Dims> &b) {
+    double distance = 0;
+    for (size_t d = 0; d < Dims; ++d) {
+        const double delta = a[d] - b[d];
+        distance += delta * delta;
+    }
+    return distance;
+}
+
+// Offsets of the 3^Dims cells around a cell, as (delta of the cell index, delta of every coordinate index)
+template <size_t Dims>
+std::vector<std::pair<std::ptrdiff_t, std::array<int, Dims>>> neighbour_offsets(size_t cells) {
+    std::vector<std::pair<std::ptrdiff_t, std::array<int, Dims>>> offsets;
+    size_t count = 1;
+    for (size_t d = 0; d < Dims; ++d) {
+        count *= 3;
+    }
+    for (size_t k = 0; k < count; ++k) {
+        std::array<int, Dims> delta;
+        std::ptrdiff_t index = 0;
+        std::ptrdiff_t stride = 1;
+        size_t rest = k;
+        for (size_t d = 0; d < Dims; ++d) {
+            delta[d] = static_cast<int>(rest % 3) - 1;
+            rest /= 3;
+            index += delta[d] * stride;
+            stride *= static_cast<std::ptrdiff_t>(cells);
+        }
+        offsets.push_back({index, delta});
+    }
+    return offsets;
+}
+
+} // namespace
+
+namespace utils {
+
+template <size_t Dims>
+PointGrid<Dims>::PointGrid(const std::vector<Point> &points, double side, size_t cells)
+    : cells_(std::max<size_t>(cells, 1)), cell_width_(side / cells_) {
+    size_t total = 1;
+    for (size_t d = 0; d < Dims; ++d) {
+        total *= cells_;
+    }
+    cell_start.assign(total + 1, 0);
+    std::vector<size_t> index(points.size());
+    for (size_t i = 0; i < points.size(); ++i) {
+        index[i] = cell_index(points[i]);
+        cell_start[index[i] + 1]++;
+    }
+    for (size_t c = 0; c < total; ++c) {
+        cell_start[c + 1] += cell_start[c];
+    }
+    std::vector<size_t> next(cell_start.begin(), cell_start.end() - 1);
+    sorted.resize(points.size());
+    for (size_t i = 0; i < points.size(); ++i) {
+        sorted[next[index[i]]++] = points[i];
+    }
+}
+
+template <size_t Dims>
+size_t PointGrid<Dims>::cell_index(const Point &point) const {
+    size_t index = 0;
+    for (size_t d = Dims; d-- > 0;) {
+        const double position = std::floor(point[d] / cell_width_);
+        const size_t cell = position <= 0 ? 0 : std::min(static_cast<size_t>(position), cells_ - 1);
+        index = index * cells_ + cell;
+    }
+    return index;
+}
+
+template <size_t Dims>
+size_t PointGrid<Dims>::cells() const {
+    return cells_;
+}
+
+template <size_t Dims>
+double PointGrid<Dims>::cell_width() const {
+    return cell_width_;
+}
+
+template <size_t Dims>
+double PointGrid<Dims>::closest_pair_squared() const {
+    const auto offsets = neighbour_offsets<Dims>(cells_);
+    double best = std::numeric_limits<double>::infinity();
+    const size_t total = cell_start.size() - 1;
+    std::array<size_t, Dims> coordinate{};
+    for (size_t c = 0; c < total; ++c) {
+        for (const auto &[delta, delta_coordinate] : offsets) {
+            // Every pair of cells is visited once, from the cell with the lower index
+            if (delta < 0) {
+                continue;
+            }
+            bool inside = true;
+            for (size_t d = 0; d < Dims; ++d) {
+                const std::ptrdiff_t neighbour = static_cast<std::ptrdiff_t>(coordinate[d]) + delta_coordinate[d];
+                inside = inside && neighbour >= 0 && neighbour < static_cast<std::ptrdiff_t>(cells_);
+            }
+            if (!inside) {
+                continue;
+            }
+            const size_t n = c + delta;
+            for (size_t i = cell_start[c]; i < cell_start[c + 1]; ++i) {
+                for (size_t j = delta == 0 ? i + 1 : cell_start[n]; j < cell_start[n + 1]; ++j) {
+                    best = std::min(best, squared_distance(sorted[i], sorted[j]));
+                }
+            }
+        }
+        for (size_t d = 0; d < Dims && ++coordinate[d] == cells_; ++d) {
+            coordinate[d] = 0;
+        }
+    }
+    return best;
+}
+
+template <size_t Dims>
+IncrementalPointGrid<Dims>::IncrementalPointGrid(double side, size_t cells)
+    : cells_(std::max<size_t>(cells, 1)), cell_width_(side / cells_) {
+    size_t total = 1;
+    for (size_t d = 0; d < Dims; ++d) {
+        total *= cells_;
+    }
+    head.assign(total, npos);
+    offsets = neighbour_offsets<Dims>(cells_);
+}
+
+template <size_t Dims>
+std::array<size_t, Dims> IncrementalPointGrid<Dims>::cell_coordinates(const Point &point) const {
+    std::array<size_t, Dims> coordinates;
+    for (size_t d = 0; d < Dims; ++d) {
+        const double position = std::floor(point[d] / cell_width_);
+        coordinates[d] = position <= 0 ? 0 : std::min(static_cast<size_t>(position), cells_ - 1);
+    }
+    return coordinates;
+}
+
+template <size_t Dims>
+size_t IncrementalPointGrid<Dims>::size() const {
+    return points.size();
+}
+
+template <size_t Dims>
+double IncrementalPointGrid<Dims>::cell_width() const {
+    return cell_width_;
+}
+
+template <size_t Dims>
+bool IncrementalPointGrid<Dims>::has_point_within(const Point &point, double distance, Norm norm) const {
+    const std::array<size_t, Dims> coordinates = cell_coordinates(point);
+    std::ptrdiff_t index = 0;
+    for (size_t d = Dims; d-- > 0;) {
+        index = index * static_cast<std::ptrdiff_t>(cells_) + static_cast<std::ptrdiff_t>(coordinates[d]);
+    }
+    for (const auto &[delta, delta_coordinate] : offsets) {
+        bool inside = true;
+        for (size_t d = 0; d < Dims; ++d) {
+            const std::ptrdiff_t neighbour = static_cast<std::ptrdiff_t>(coordinates[d]) + delta_coordinate[d];
+            inside = inside && neighbour >= 0 && neighbour < static_cast<std::ptrdiff_t>(cells_);
+        }
+        if (!inside) {
+            continue;
+        }
+        for (size_t i = head[index + delta]; i != npos; i = next[i]) {
+            if (norm == Norm::euclidean) {
+                if (squared_distance(point, points[i]) <= distance * distance) {
+                    return true;
+                }
+            } else {
+                bool near = true;
+                for (size_t d = 0; d < Dims; ++d) {
+                    near = near && std::abs(point[d] - points[i][d]) <= distance;
+                }
+                if (near) {
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+template <size_t Dims>
+void IncrementalPointGrid<Dims>::insert(const Point &point) {
+    const std::array<size_t, Dims> coordinates = cell_coordinates(point);
+    size_t index = 0;
+    for (size_t d = Dims; d-- > 0;) {
+        index = index * cells_ + coordinates[d];
+    }
+    next.push_back(head[index]);
+    head[index] = points.size();
+    points.push_back(point);
+}
+
+template <size_t Dims>
+double closest_pair_squared(const std::vector<std::array<double, Dims>> &points, double side) {
+    const size_t cells = static_cast<size_t>(std::pow(static_cast<double>(points.size()), 1.0 / Dims));
+    PointGrid<Dims> grid(points, side, cells);
+    double best = grid.closest_pair_squared();
+    if (best <= grid.cell_width() * grid.cell_width()) {
+        return best;
+    }
+    std::vector<std::array<double, Dims>> by_x = points;
+    std::sort(by_x.begin(), by_x.end(), [](const auto &a, const auto &b) { return a[0] < b[0]; });
+    for (size_t i = 1; i < by_x.size(); ++i) {
+        for (size_t j = i; j-- > 0;) {
+            const double dx = by_x[i][0] - by_x[j][0];
+            if (dx * dx >= best) {
+                break;
+            }
+            best = std::min(best, squared_distance(by_x[i], by_x[j]));
+        }
+    }
+    return best;
+}
+
+template class PointGrid<2>;
+template class PointGrid<3>;
+template class IncrementalPointGrid<2>;
+template class IncrementalPointGrid<3>;
+
+template double closest_pair_squared<2>(const std::vector<std::array<double, 2>> &points, double side);
+template double closest_pair_squared<3>(const std::vector<std::array<double, 3>> &points, double side);
+
+} // namespace utils
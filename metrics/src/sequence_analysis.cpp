@@ -0,0 +1,86 @@
+#include "metrics/sequence_analysis.hpp"
+
+#include "metrics/pattern_counts.hpp"
+
+namespace utils {
+
+SequenceAnalysis::SequenceAnalysis(const seq_bytes &bytes) : bytes_(bytes) {
+}
+
+const seq_bytes &SequenceAnalysis::bytes() const {
+    return bytes_;
+}
+
+size_t SequenceAnalysis::size() const {
+    return bytes_.size();
+}
+
+// The artifacts are computed without holding the mutex: the computation may run on the thread pool, and a thread
+// waiting for its tasks may pick up another test of the same sequence. Threads racing for the same artifact compute
+// it twice and keep the first result
+
+size_t SequenceAnalysis::ones() const {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (ones_) {
+            return *ones_;
+        }
+    }
+    size_t count = 0;
+    for (unsigned char bit : bytes_) {
+        count += bit;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    ones_ = count;
+    return count;
+}
+
+const std::vector<std::uint64_t> &SequenceAnalysis::packed_bits() const {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!packed_bits_.empty()) {
+            return packed_bits_;
+        }
+    }
+    std::vector<std::uint64_t> words = pack_bits(bytes_);
+    std::lock_guard<std::mutex> lock(mutex);
+    if (packed_bits_.empty()) {
+        packed_bits_ = std::move(words);
+    }
+    return packed_bits_;
+}
+
+void SequenceAnalysis::release_packed_bits() {
+    std::lock_guard<std::mutex> lock(mutex);
+    packed_bits_ = {};
+}
+
+const std::vector<size_t> &SequenceAnalysis::pattern_counts(size_t m) const {
+    std::vector<size_t> counts;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = pattern_counts_.find(m);
+        if (it != pattern_counts_.end()) {
+            return it->second;
+        }
+        auto higher = pattern_counts_.upper_bound(m);
+        if (higher != pattern_counts_.end()) {
+            counts = marginalize_pattern_counts(higher->second);
+        }
+    }
+    if (counts.empty()) {
+        counts = overlapping_pattern_counts(bytes_, m);
+    }
+    while (counts.size() > (size_t(1) << m)) {
+        counts = marginalize_pattern_counts(counts);
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    return pattern_counts_.emplace(m, std::move(counts)).first->second;
+}
+
+void SequenceAnalysis::release_pattern_counts() {
+    std::lock_guard<std::mutex> lock(mutex);
+    pattern_counts_.clear();
+}
+
+} // namespace utils
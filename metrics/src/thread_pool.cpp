@@ -0,0 +1,232 @@
+#include "metrics/thread_pool.hpp"
+
+#include <chrono>
+#include <set>
+
+namespace utils {
+
+namespace {
+
+// Pool and queue index of the current worker thread
+thread_local ThreadPool *current_pool = nullptr;
+thread_local size_t current_index = 0;
+
+std::mutex global_mutex;
+std::unique_ptr<ThreadPool> global_pool;
+
+} // namespace
+
+ThreadPool::ThreadPool(size_t threads) {
+    size_t count = std::max<size_t>(threads, 1) - 1;
+    for (size_t i = 0; i <= count; ++i) {
+        queues.push_back(std::make_unique<Queue>());
+    }
+    for (size_t i = 0; i < count; ++i) {
+        workers.emplace_back([this, i] { worker_loop(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto &worker : workers) {
+        worker.join();
+    }
+}
+
+ThreadPool &ThreadPool::global() {
+    std::lock_guard<std::mutex> lock(global_mutex);
+    if (!global_pool) {
+        global_pool = std::make_unique<ThreadPool>(std::max(std::thread::hardware_concurrency(), 1U));
+    }
+    return *global_pool;
+}
+
+void ThreadPool::set_global_threads(size_t threads) {
+    std::lock_guard<std::mutex> lock(global_mutex);
+    global_pool = std::make_unique<ThreadPool>(threads);
+}
+
+size_t ThreadPool::size() const {
+    return workers.size() + 1;
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    Queue &queue = current_pool == this ? *queues[current_index] : *queues.back();
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+    }
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        ++queued;
+    }
+    wake.notify_one();
+}
+
+bool ThreadPool::pop(Queue &queue, bool back, std::function<void()> &task) {
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty()) {
+            return false;
+        }
+        if (back) {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        } else {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+    }
+    std::lock_guard<std::mutex> lock(sleep_mutex);
+    --queued;
+    return true;
+}
+
+bool ThreadPool::run_pending_task() {
+    std::function<void()> task;
+    bool own = current_pool == this;
+    // The newest own task first, it works on the data in cache, then the oldest tasks of the others
+    bool found = own && pop(*queues[current_index], true, task);
+    for (size_t i = 0; !found && i < queues.size(); ++i) {
+        size_t index = own ? (current_index + 1 + i) % queues.size() : (queues.size() - 1 + i) % queues.size();
+        found = pop(*queues[index], false, task);
+    }
+    if (!found) {
+        return false;
+    }
+    task();
+    return true;
+}
+
+void ThreadPool::worker_loop(size_t index) {
+    current_pool = this;
+    current_index = index;
+    while (true) {
+        if (run_pending_task()) {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleep_mutex);
+        wake.wait(lock, [this] { return stopping || queued != 0; });
+        if (stopping) {
+            return;
+        }
+    }
+}
+
+TaskGroup::TaskGroup(ThreadPool &pool) : pool(pool) {
+}
+
+TaskGroup::~TaskGroup() {
+    try {
+        wait();
+    } catch (...) {
+    }
+}
+
+void TaskGroup::run(std::function<void()> task) {
+    pending.fetch_add(1);
+    pool.submit([this, task = std::move(task)] {
+        try {
+            task();
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!exception) {
+                exception = std::current_exception();
+            }
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        if (pending.fetch_sub(1) == 1) {
+            done.notify_all();
+        }
+    });
+}
+
+void TaskGroup::wait() {
+    while (pending.load() != 0) {
+        if (pool.run_pending_task()) {
+            continue;
+        }
+        // The remaining tasks run on other threads, they may still spawn tasks this thread can help with
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait_for(lock, std::chrono::microseconds(200), [this] { return pending.load() == 0; });
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    if (exception) {
+        std::exception_ptr e = exception;
+        exception = nullptr;
+        std::rethrow_exception(e);
+    }
+}
+
+size_t TaskGraph::add(std::function<void()> task, const std::vector<size_t> &dependencies) {
+    size_t id = nodes.size();
+    nodes.push_back({std::move(task), {}, dependencies.size()});
+    for (size_t dependency : dependencies) {
+        nodes[dependency].successors.push_back(id);
+    }
+    return id;
+}
+
+void TaskGraph::run(size_t max_concurrency, ThreadPool &pool) {
+    if (max_concurrency == 0) {
+        max_concurrency = nodes.size();
+    }
+    std::vector<size_t> dependencies(nodes.size());
+    std::set<size_t> ready;
+    for (size_t id = 0; id < nodes.size(); ++id) {
+        dependencies[id] = nodes[id].dependencies;
+        if (dependencies[id] == 0) {
+            ready.insert(id);
+        }
+    }
+    std::mutex mutex;
+    std::exception_ptr exception;
+    size_t runners = 0;
+    TaskGroup group(pool);
+    // Every runner takes ready tasks until there are none, and starts more runners when a finished task makes
+    // several successors ready
+    std::function<void()> runner = [&] {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!ready.empty()) {
+            size_t id = *ready.begin();
+            ready.erase(ready.begin());
+            lock.unlock();
+            try {
+                nodes[id].task();
+            } catch (...) {
+                std::lock_guard<std::mutex> exception_lock(mutex);
+                if (!exception) {
+                    exception = std::current_exception();
+                }
+            }
+            lock.lock();
+            for (size_t successor : nodes[id].successors) {
+                if (--dependencies[successor] == 0) {
+                    ready.insert(successor);
+                }
+            }
+            for (size_t extra = ready.size(); extra > 1 && runners < max_concurrency; --extra) {
+                ++runners;
+                group.run(runner);
+            }
+        }
+        --runners;
+    };
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t i = 0; i < ready.size() && runners < max_concurrency; ++i) {
+            ++runners;
+            group.run(runner);
+        }
+    }
+    group.wait();
+    if (exception) {
+        std::rethrow_exception(exception);
+    }
+}
+
+} // namespace utils
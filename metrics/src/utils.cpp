@@ -4,8 +4,11 @@
 #include <boost/math/special_functions/gamma.hpp>
 #include <cmath>
 #include <complex>
+#include <cstring>
 #include <filesystem>
 
+#include "metrics/thread_pool.hpp"
+
 namespace utils {
 
 size_t get_max_run(const seq_bytes &seq, size_t left_border, size_t right_border) {
@@ -70,28 +73,48 @@ double poissonian(int k, double lambda) {
     return std::pow(lambda, k) * std::exp(-lambda) / boost::math::factorial<double>(k);
 }
 
-std::vector<double> bits_to_doubles(const seq_bytes &bytes, int num_floats) {
-    // Converts bits to doubles [0;1)
-
-    std::vector<uint64_t> uintValues = bits_to_vector_uint<uint64_t>(bytes, num_floats);
-
+std::vector<double> bits_to_doubles(const seq_bytes &bytes, int num_floats, BitOrder order) {
+    // Converts bits to doubles [0;1): the 52 highest bits of the integer become the mantissa of a double of [1;2)
     std::vector<double> doubleVector(num_floats);
-    const double maxUInt64 = static_cast<double>(UINT64_MAX);
-
-    for (int i = 0; i < num_floats; ++i) {
-        doubleVector[i] = static_cast<double>(uintValues[i]) / maxUInt64;
-    }
+    parallel_for(
+        doubleVector.size(),
+        [&](size_t first, size_t last) {
+            for (size_t i = first; i < last; ++i) {
+                const std::uint64_t mantissa = bits_to_uint<std::uint64_t>(bytes, 64 * i, order) >> 12;
+                const std::uint64_t representation = 0x3FF0000000000000ULL | mantissa;
+                double value;
+                std::memcpy(&value, &representation, sizeof(value));
+                doubleVector[i] = value - 1.0;
+            }
+        },
+        1 << 14);
 
     return doubleVector;
 }
 
-std::vector<double> random_doubles(int num_doubles) {
-    std::vector<double> result_doubles(num_doubles);
-    for (size_t i = 0; i < num_doubles; i++) {
-        double x = ((double)std::rand() / (RAND_MAX));
-        result_doubles.push_back(x);
+std::vector<std::uint64_t> pack_bits(const seq_bytes &bytes) {
+    return pack_bits(bytes, bytes.size());
+}
+
+std::vector<std::uint64_t> pack_bits(const seq_bytes &bytes, size_t count) {
+    const size_t n = std::min(count, bytes.size());
+    std::vector<std::uint64_t> words(n / 64 + 2, 0);
+    parallel_for(
+        n / 64,
+        [&](size_t first, size_t last) {
+            for (size_t w = first; w < last; ++w) {
+                std::uint64_t word = 0;
+                for (size_t g = 0; g < 8; ++g) {
+                    word = (word << 8) | gather_bits(bytes.data() + 64 * w + 8 * g, BitOrder::msb_first);
+                }
+                words[w] = word;
+            }
+        },
+        1 << 14);
+    for (size_t i = n / 64 * 64; i < n; ++i) {
+        words[i / 64] |= static_cast<std::uint64_t>(bytes[i]) << (63 - i % 64);
     }
-    return result_doubles;
+    return words;
 }
 
 double kstest(std::vector<double> p_values) {
@@ -101,8 +124,9 @@ double kstest(std::vector<double> p_values) {
         return -1;
     if (count == 1)
         return p_values[0];
+    std::sort(p_values.begin(), p_values.end());
     double d_max = 0.0;
-    for (size_t i = 0; i < count; i++) {
+    for (size_t i = 1; i <= count; i++) {
         double y = (double)i / (count + 1.0);
         double d1 = p_values[i - 1] - y;
         double d2 = std::abs(1.0 / (count + 1.0) - d1);
@@ -112,33 +136,29 @@ double kstest(std::vector<double> p_values) {
             d_max = d;
     }
     double s = d_max * d_max * count;
-    return 2.0 * std::exp(-(2.000071 + .331 / std::sqrt(count) + 1.409 / count) * s);
+    // The asymptotic series exceeds 1 for small distances
+    return std::min(1.0, 2.0 * std::exp(-(2.000071 + .331 / std::sqrt(count) + 1.409 / count) * s));
 }
 
-int kperm(const std::vector<int> &v) {
+int kperm(std::array<int, 5> w) {
     // This function computes a unique permutation index for a given array of five integers.
     // This index uniquely represents the ordering of the integers in a factoradic numbering system, effectively mapping
     // the permutation to a specific number.
-    std::vector<int> w = v;
-    int pindex = 0, uret, tmp;
-
-    // Work on a copy of v, not v itself in case we are using overlapping 5-patterns.
+    // The array is taken by value and the loops are fully unrolled, so the window stays in registers and the maximum
+    // is selected with conditional moves instead of unpredictable branches.
+    int pindex = 0;
     for (int i = 4; i > 0; --i) {
         int max = w[0];
         int k = 0;
         for (int j = 1; j <= i; ++j) {
-            if (max <= w[j]) {
-                max = w[j];
-                k = j;
-            }
+            const bool greater = max <= w[j];
+            max = greater ? w[j] : max;
+            k = greater ? j : k;
         }
         pindex = (i + 1) * pindex + k;
         std::swap(w[i], w[k]);
     }
-
-    uret = pindex;
-
-    return uret;
+    return pindex;
 }
 
 void save_string_to_file(const std::string &path, const std::string &str, bool append) {
@@ -132,7 +132,7 @@ TEST(MT, overlapping_template_matching_mt) {
     utils::seq_bytes template_ = {1, 1, 1, 1, 1, 1, 1, 1, 1};
     double p = nist::overlapping_template_matching(bytes, template_);
     std::cout << "P-value: " << p << std::endl;
-    ASSERT_FALSE(nist::check_overlapping_template_matching(bytes, template_));
+    ASSERT_TRUE(nist::check_overlapping_template_matching(bytes, template_));
 }
 
 TEST(MT, universal_digit_mt) {
@@ -346,7 +346,7 @@ TEST(MT, overlapping_template_matching_mt_64) {
     utils::seq_bytes template_ = {1, 1, 1, 1, 1, 1, 1, 1, 1};
     double p = nist::overlapping_template_matching(bytes, template_);
     std::cout << "P-value: " << p << std::endl;
-    ASSERT_FALSE(nist::check_overlapping_template_matching(bytes, template_));
+    ASSERT_TRUE(nist::check_overlapping_template_matching(bytes, template_));
 }
 
 TEST(MT, universal_digit_mt_64) {
@@ -560,7 +560,7 @@ TEST(MT, overlapping_template_matching_mt_64_1) {
     utils::seq_bytes template_ = {1, 1, 1, 1, 1, 1, 1, 1, 1};
     double p = nist::overlapping_template_matching(bytes, template_);
     std::cout << "P-value: " << p << std::endl;
-    ASSERT_FALSE(nist::check_overlapping_template_matching(bytes, template_));
+    ASSERT_TRUE(nist::check_overlapping_template_matching(bytes, template_));
 }
 
 TEST(MT, universal_digit_mt_64_1) {
@@ -774,7 +774,7 @@ TEST(MT, overlapping_template_matching_mt_64_2) {
     utils::seq_bytes template_ = {1, 1, 1, 1, 1, 1, 1, 1, 1};
     double p = nist::overlapping_template_matching(bytes, template_);
     std::cout << "P-value: " << p << std::endl;
-    ASSERT_FALSE(nist::check_overlapping_template_matching(bytes, template_));
+    ASSERT_TRUE(nist::check_overlapping_template_matching(bytes, template_));
 }
 
 TEST(MT, universal_digit_mt_64_2) {
@@ -988,7 +988,7 @@ TEST(MT, overlapping_template_matching_mt_64_3) {
     utils::seq_bytes template_ = {1, 1, 1, 1, 1, 1, 1, 1, 1};
     double p = nist::overlapping_template_matching(bytes, template_);
     std::cout << "P-value: " << p << std::endl;
-    ASSERT_FALSE(nist::check_overlapping_template_matching(bytes, template_));
+    ASSERT_TRUE(nist::check_overlapping_template_matching(bytes, template_));
 }
 
 TEST(MT, universal_digit_mt_64_3) {
@@ -1227,7 +1227,7 @@ TEST(MTSBOX, overlapping_template_matching_mt) {
     utils::seq_bytes template_ = {1, 1, 1, 1, 1, 1, 1, 1, 1};
     double p = nist::overlapping_template_matching(bytes, template_);
     std::cout << "P-value: " << p << std::endl;
-    ASSERT_FALSE(nist::check_overlapping_template_matching(bytes, template_));
+    ASSERT_TRUE(nist::check_overlapping_template_matching(bytes, template_));
 }
 
 TEST(MTSBOX, universal_digit_mt) {
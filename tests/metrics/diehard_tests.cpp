@@ -1,11 +1,23 @@
 #include <gtest/gtest.h>
 
 #include "metrics/diehard_tests.hpp"
+#include "statistical_test/diehard.hpp"
 
 #include <iostream>
+#include <numeric>
+#include <random>
 
 constexpr double abs_error = 1e-6;
 
+utils::seq_bytes random_bits(size_t count, unsigned seed) {
+    std::mt19937 generator(seed);
+    utils::seq_bytes bytes(count);
+    for (auto &bit : bytes) {
+        bit = generator() & 1;
+    }
+    return bytes;
+}
+
 TEST(Diehard, runs_test) {
     utils::seq_bytes bytes = {1, 1, 0, 0, 1, 0, 0, 1, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 0, 1, 1, 0, 1, 0, 1,
                               0, 1, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 1, 1, 0, 1, 0, 0, 0, 1, 1,
@@ -40,14 +52,43 @@ TEST(Diehard, binary_matrix_rank_e) {
     ASSERT_NEAR(p, answer, abs_error);
 }
 
+// p-values of a good generator are uniform, so they must pass the KS test and about a tenth of them is below 0.1
+void check_birthdays_p_values(int days_bits, int num_bdays, int tsamples, unsigned num_seeds) {
+    std::vector<double> p_values;
+    size_t below_tenth = 0;
+    for (unsigned seed = 1; seed <= num_seeds; ++seed) {
+        utils::seq_bytes bytes = random_bits(static_cast<size_t>(days_bits) * num_bdays * tsamples, seed);
+        double p = diehard::birthdays_test(bytes, days_bits, num_bdays, tsamples);
+        ASSERT_GE(p, 0.0);
+        ASSERT_LE(p, 1.0);
+        p_values.push_back(p);
+        below_tenth += p < 0.1;
+    }
+    ASSERT_GT(utils::kstest(p_values), 0.01);
+    ASSERT_LT(below_tenth, num_seeds / 5);
+}
+
 TEST(Diehard, birthdays_test_random) {
+    check_birthdays_p_values(24, 512, 100, 150);
+}
+
+TEST(Diehard, birthdays_test_large_days) {
+    check_birthdays_p_values(40, 1 << 14, 20, 20);
+}
+
+TEST(Diehard, birthdays_test_e) {
     int days_bits = 24;
     int num_bdays = 512;
-    int tsamples = 100;
-    utils::seq_bytes bytes = utils::read_bits_from_exponent(days_bits * num_bdays + tsamples * 32);
+    int tsamples = 80;
+    utils::seq_bytes bytes = utils::read_bits_from_exponent(days_bits * num_bdays * tsamples);
     double p = diehard::birthdays_test(bytes, days_bits, num_bdays, tsamples);
-    double answer = 0.017107409200810778;
-    ASSERT_NEAR(p, answer, abs_error);
+    ASSERT_GT(p, 0.01);
+    ASSERT_THROW(diehard::birthdays_test(bytes, days_bits, num_bdays, tsamples + 1), std::runtime_error);
+}
+
+TEST(Diehard, birthdays_test_short_sequence) {
+    utils::seq_bytes bytes = utils::read_bits_from_exponent(1000);
+    ASSERT_THROW(diehard::birthdays_test(bytes, 24, 512, 100), std::runtime_error);
 }
 
 TEST(Diehard, minimum_distance_test_2d_random) {
@@ -56,8 +97,8 @@ TEST(Diehard, minimum_distance_test_2d_random) {
     int num_samples = 10;
     utils::seq_bytes bytes = utils::read_bits_from_exponent(n_dims * num_coordinates * num_samples * 64);
     double p = diehard::minimum_distance_test(bytes, n_dims, num_coordinates, num_samples);
-    double limit = 0.05;
-    ASSERT_LE(p, limit);
+    double answer = 0.081563464;
+    ASSERT_NEAR(p, answer, abs_error);
 }
 
 TEST(Diehard, overlapping_permutations_test_random) {
@@ -68,14 +109,27 @@ TEST(Diehard, overlapping_permutations_test_random) {
     ASSERT_NEAR(p, answer, abs_error);
 }
 
+TEST(Diehard, overlapping_permutations_test_many_samples) {
+    int num_samples = 30000;
+    utils::seq_bytes bytes = utils::read_bits_from_exponent((num_samples + 4) * 32);
+    double p = diehard::overlapping_permutations_test(bytes, num_samples);
+    ASSERT_GT(p, 0.01);
+    ASSERT_LE(p, 1.0);
+}
+
+TEST(Diehard, overlapping_permutations_test_short_sequence) {
+    utils::seq_bytes bytes = utils::read_bits_from_exponent(1000);
+    ASSERT_THROW(diehard::overlapping_permutations_test(bytes, 1000), std::runtime_error);
+}
+
 TEST(Diehard, minimum_distance_test_3d_random) {
     int n_dims = 3;
-    int num_coordinates = 400;
+    int num_coordinates = 200;
     int num_samples = 10;
     utils::seq_bytes bytes = utils::read_bits_from_exponent(n_dims * num_coordinates * num_samples * 64);
     double p = diehard::minimum_distance_test(bytes, n_dims, num_coordinates, num_samples);
-    double limit = 0.05;
-    ASSERT_LE(p, limit);
+    double answer = 0.443825932;
+    ASSERT_NEAR(p, answer, abs_error);
 }
 
 TEST(Diehard, monkey_test) {
@@ -85,6 +139,24 @@ TEST(Diehard, monkey_test) {
     ASSERT_GT(p, 0.1);
 }
 
+TEST(Diehard, base_5_word_counts_count_every_word) {
+    int num_samples = 10000;
+    utils::seq_bytes bytes = utils::read_bits_from_exponent(num_samples + 12);
+    auto [counts_5, counts_4] = diehard::base_5_word_counts(bytes, num_samples);
+    ASSERT_EQ(counts_5.size(), 3125);
+    ASSERT_EQ(counts_4.size(), 625);
+    ASSERT_EQ(std::accumulate(counts_5.begin(), counts_5.end(), size_t(0)), num_samples + 1);
+    ASSERT_EQ(std::accumulate(counts_4.begin(), counts_4.end(), size_t(0)), num_samples + 1);
+    // The first word is made of the bytes at bits 0 ... 11
+    size_t word = 0;
+    for (size_t p = 0; p < 5; ++p) {
+        int ones = std::accumulate(bytes.begin() + p, bytes.begin() + p + 8, 0);
+        word = word * 5 + (ones <= 2 ? 0 : ones >= 6 ? 4 : ones - 2);
+    }
+    ASSERT_GE(counts_5[word], 1);
+    ASSERT_THROW(diehard::base_5_word_counts(bytes, num_samples + 1), std::runtime_error);
+}
+
 TEST(Diehard, squeeze_test) {
     int num_samples = 200;
     utils::seq_bytes bytes = utils::read_bits_from_exponent();
@@ -100,8 +172,121 @@ TEST(Diehard, sums_test) {
 }
 
 TEST(Diehard, craps_test_random) {
-    int num_games = 2000;
-    utils::seq_bytes bytes = utils::read_bits_from_exponent(num_games * 4 * 32);
+    int num_games = 240;
+    utils::seq_bytes bytes = utils::read_bits_from_exponent(num_games * 64 * 64);
+    double p = diehard::craps_test(bytes, num_games);
+    ASSERT_GT(p, 0.01);
+    ASSERT_THROW(diehard::craps_test(bytes, num_games + 1), std::runtime_error);
+}
+
+TEST(Diehard, craps_test_many_games) {
+    int num_games = 16000;
+    utils::seq_bytes bytes = random_bits(num_games * 64 * 64, 5);
     double p = diehard::craps_test(bytes, num_games);
     ASSERT_GT(p, 0.01);
+    ASSERT_LE(p, 1.0);
+}
+
+TEST(Diehard, craps_test_minimum_sequence) {
+    // The games of the shortest accepted sequences are independent, so their p-values are uniform
+    int num_games = 1000;
+    std::vector<double> p_values;
+    for (unsigned seed = 1; seed <= 30; ++seed) {
+        utils::seq_bytes bytes = random_bits(num_games * 64 * 64, seed);
+        p_values.push_back(diehard::craps_test(bytes, num_games));
+        bytes.pop_back();
+        ASSERT_THROW(diehard::craps_test(bytes, num_games), std::runtime_error);
+    }
+    ASSERT_GT(utils::kstest(p_values), 0.01);
+}
+
+TEST(Diehard, squeeze_and_craps_short_sequence) {
+    utils::seq_bytes bytes = utils::read_bits_from_exponent(1000);
+    ASSERT_THROW(diehard::squeeze_test(bytes, 200), std::runtime_error);
+    ASSERT_THROW(diehard::craps_test(bytes, 2000), std::runtime_error);
+}
+
+TEST(Diehard, sparse_occupancy_tests_random) {
+    utils::seq_bytes bytes = random_bits(((1 << 21) + 9) * 10, 1);
+    double p = diehard::opso_test(bytes, 1);
+    ASSERT_GT(p, 0.01);
+    ASSERT_LT(p, 0.99);
+    p = diehard::oqso_test(bytes, 2);
+    ASSERT_GT(p, 0.01);
+    ASSERT_LE(p, 1.0);
+    p = diehard::dna_test(bytes, 5);
+    ASSERT_GT(p, 0.01);
+    ASSERT_LE(p, 1.0);
+}
+
+TEST(Diehard, sparse_occupancy_tests_constant_sequence) {
+    utils::seq_bytes bytes(((1 << 21) + 9) * 2, 0);
+    // Only the zero word occurs
+    ASSERT_LT(diehard::dna_test(bytes, 1), 0.01);
+    ASSERT_THROW(diehard::oqso_test(bytes, 1), std::runtime_error);
+}
+
+TEST(Diehard, parking_lot_and_spheres_tests_random) {
+    utils::seq_bytes bytes = random_bits(3 * 12000 * 2 * 64, 2);
+    double p = diehard::parking_lot_test(bytes, 3);
+    ASSERT_GT(p, 0.01);
+    ASSERT_LE(p, 1.0);
+    p = diehard::spheres_3d_test(bytes, 6);
+    ASSERT_GT(p, 0.01);
+    ASSERT_LE(p, 1.0);
+    ASSERT_THROW(diehard::spheres_3d_test(bytes, 7), std::runtime_error);
+}
+
+TEST(Diehard, count_ones_tests) {
+    utils::seq_bytes bytes = utils::read_bits_from_exponent();
+    double p = diehard::count_ones_stream_test(bytes, 100000);
+    ASSERT_GT(p, 0.01);
+    ASSERT_LT(p, 0.99);
+    p = diehard::count_ones_bytes_test(bytes, 30000);
+    ASSERT_GT(p, 0.01);
+    ASSERT_LE(p, 1.0);
+    ASSERT_THROW(diehard::count_ones_byte_test(bytes, 30000, 25), std::runtime_error);
+    ASSERT_THROW(diehard::count_ones_stream_test(bytes, 200000), std::runtime_error);
+}
+
+TEST(Diehard, count_ones_stream_test_periodic_sequence) {
+    utils::seq_bytes bytes(8 * 100004);
+    for (size_t i = 0; i < bytes.size(); ++i) {
+        bytes[i] = i % 8 < 4;
+    }
+    // Every letter is C, so only one word occurs
+    ASSERT_LT(diehard::count_ones_stream_test(bytes, 100000), 0.01);
+}
+
+TEST(Diehard, merge_equals_sequential_test) {
+    std::vector<utils::seq_bytes> sequences = {random_bits(((1 << 21) + 9) * 10, 3),
+                                               random_bits(((1 << 21) + 9) * 10, 4)};
+    statistical_test::DiehardTest sequential;
+    statistical_test::DiehardTest first;
+    statistical_test::DiehardTest second;
+    sequential.test(sequences[0]);
+    sequential.test(sequences[1]);
+    first.test(sequences[0]);
+    second.test(sequences[1]);
+    first.merge(second);
+    ASSERT_TRUE(first == sequential);
+    ASSERT_FALSE(second == sequential);
+}
+
+TEST(Diehard, diehard_test_short_sequence) {
+    utils::seq_bytes bytes = random_bits(((1 << 21) + 1) * 10 - 1, 6);
+    statistical_test::DiehardTest test;
+    ASSERT_THROW(test.test(bytes), std::runtime_error);
+    ASSERT_TRUE(test == statistical_test::DiehardTest());
+}
+
+TEST(Diehard, diehard_test_random_passes_birthdays) {
+    statistical_test::DiehardTest test;
+    for (unsigned seed = 7; seed < 10; ++seed) {
+        test.test(random_bits(((1 << 21) + 1) * 10, seed));
+    }
+    testing::internal::CaptureStdout();
+    test.print_statistics("mt19937");
+    std::string statistics = testing::internal::GetCapturedStdout();
+    ASSERT_NE(statistics.find("Birthdays test: Pass (3 / 3)"), std::string::npos) << statistics;
 }
@@ -0,0 +1,109 @@
+#include <gtest/gtest.h>
+
+#include <random>
+
+#include "metrics/fft.hpp"
+#include "metrics/nist_tests.hpp"
+
+constexpr double abs_error = 1e-9;
+
+TEST(FFT, real_plan_matches_fft) {
+    utils::seq_bytes bytes = utils::read_bits_from_exponent(1024);
+    std::vector<short> x(bytes.size());
+    for (size_t i = 0; i < bytes.size(); ++i) {
+        x[i] = 2 * bytes[i] - 1;
+    }
+    std::vector<std::complex<double>> answer = utils::FFT(x);
+    std::vector<std::complex<double>> X = utils::RealFFTPlan<double>::get(bytes.size())->transform(bytes);
+    ASSERT_EQ(X.size(), bytes.size() / 2);
+    for (size_t i = 0; i < X.size(); ++i) {
+        ASSERT_NEAR(std::abs(X[i]), std::abs(answer[i]), abs_error);
+    }
+}
+
+TEST(FFT, real_plan_count_below) {
+    utils::seq_bytes bytes = utils::read_bits_from_exponent(4096);
+    auto plan = utils::RealFFTPlan<double>::get(bytes.size());
+    std::vector<std::complex<double>> X = plan->transform(bytes);
+    double threshold = std::sqrt(std::log(1 / 0.05) * bytes.size());
+    size_t answer = 0;
+    for (const auto &value : X) {
+        answer += std::abs(value) < threshold;
+    }
+    ASSERT_EQ(plan->count_below(bytes, threshold), answer);
+}
+
+TEST(FFT, real_plan_is_cached) {
+    ASSERT_EQ(utils::RealFFTPlan<double>::get(256), utils::RealFFTPlan<double>::get(256));
+    ASSERT_NE(utils::RealFFTPlan<double>::get(256), utils::RealFFTPlan<double>::get(512));
+}
+
+TEST(FFT, real_plan_cache_keeps_recent_sizes) {
+    auto plan = utils::RealFFTPlan<double>::get(256);
+    for (size_t i = 1; i <= utils::RealFFTPlan<double>::cached_plans; ++i) {
+        utils::RealFFTPlan<double>::get(256 + 2 * i);
+    }
+    // The plan of 256 was evicted, the one still held stays valid
+    ASSERT_NE(utils::RealFFTPlan<double>::get(256), plan);
+    ASSERT_EQ(plan->size(), 256);
+}
+
+TEST(FFT, discrete_fourier_transform_float) {
+    utils::seq_bytes bytes = utils::read_bits_from_exponent(1 << 20);
+    double p = nist::discrete_fourier_transform(bytes);
+    double p_float = nist::discrete_fourier_transform(bytes, utils::FFTPrecision::Float);
+    ASSERT_NEAR(p, p_float, 1e-6);
+}
+
+TEST(FFT, complex_plan_matches_dft) {
+    // Smooth sizes use the mixed radix path, 97 and 1018 = 2 * 509 go through Bluestein.
+    // utils::DFT uses the positive exponent, so its result is the conjugate of the forward transform
+    for (size_t size : {1, 2, 3, 5, 10, 12, 45, 97, 1000, 1018}) {
+        std::vector<short> x(size);
+        std::vector<std::complex<double>> in(size);
+        for (size_t i = 0; i < size; ++i) {
+            x[i] = static_cast<short>((i * 7 + i / 3) % 5) - 2;
+            in[i] = x[i];
+        }
+        std::vector<std::complex<double>> answer = utils::DFT(x);
+        std::vector<std::complex<double>> X(size);
+        utils::ComplexFFTPlan<double>(size).transform(in.data(), X.data());
+        for (size_t i = 0; i < size; ++i) {
+            ASSERT_NEAR(X[i].real(), answer[i].real(), 1e-8) << "size " << size << " index " << i;
+            ASSERT_NEAR(X[i].imag(), -answer[i].imag(), 1e-8) << "size " << size << " index " << i;
+        }
+    }
+}
+
+TEST(FFT, real_plan_any_size) {
+    for (size_t size : {100, 999, 1000, 1018}) {
+        utils::seq_bytes bytes = utils::read_bits_from_exponent(size);
+        std::vector<short> x(size);
+        for (size_t i = 0; i < size; ++i) {
+            x[i] = 2 * bytes[i] - 1;
+        }
+        std::vector<std::complex<double>> answer = utils::DFT(x);
+        std::vector<std::complex<double>> X = utils::RealFFTPlan<double>::get(size)->transform(bytes);
+        ASSERT_EQ(X.size(), size / 2);
+        for (size_t i = 0; i < X.size(); ++i) {
+            ASSERT_NEAR(std::abs(X[i]), std::abs(answer[i]), 1e-8) << "size " << size << " index " << i;
+        }
+    }
+}
+
+TEST(FFT, six_step_matches_fft) {
+    const size_t size = utils::RealFFTPlan<double>::blocked_threshold;
+    std::mt19937 generator(42);
+    utils::seq_bytes bytes(size);
+    std::vector<short> x(size);
+    for (size_t i = 0; i < size; ++i) {
+        bytes[i] = generator() & 1;
+        x[i] = 2 * bytes[i] - 1;
+    }
+    std::vector<std::complex<double>> answer = utils::FFT(x);
+    std::vector<std::complex<double>> X = utils::RealFFTPlan<double>::get(size)->transform(bytes);
+    ASSERT_EQ(X.size(), size / 2);
+    for (size_t i = 0; i < X.size(); ++i) {
+        ASSERT_NEAR(std::abs(X[i]), std::abs(answer[i]), 1e-6) << "index " << i;
+    }
+}
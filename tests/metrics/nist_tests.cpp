@@ -3,6 +3,7 @@
 #include <random>
 
 #include "metrics/nist_tests.hpp"
+#include "statistical_test/nist.hpp"
 
 constexpr double abs_error = 1e-6;
 
@@ -130,6 +131,13 @@ TEST(Nist, overlapping_template_matching_2) {
     ASSERT_NEAR(p, answer, abs_error);
 }
 
+TEST(Nist, overlapping_template_matching_short_sequence) {
+    utils::seq_bytes bytes = utils::read_bits_from_exponent(1000);
+    utils::seq_bytes template_ = {1, 1, 1, 1, 1, 1, 1, 1, 1};
+    ASSERT_THROW(nist::overlapping_template_matching(bytes, template_, 1032, 968, 5), std::runtime_error);
+    ASSERT_THROW(nist::overlapping_template_matching(bytes, template_, 0, 968, 5), std::runtime_error);
+}
+
 TEST(Nist, linear_complexity) {
     utils::seq_bytes bytes = utils::read_bits_from_exponent(1'000'000);
     double p = nist::linear_complexity(bytes, 1000);
@@ -137,6 +145,20 @@ TEST(Nist, linear_complexity) {
     ASSERT_NEAR(p, answer, abs_error);
 }
 
+TEST(Nist, linear_complexity_digit_e) {
+    utils::seq_bytes bytes = utils::read_bits_from_exponent();
+    double p = nist::linear_complexity(bytes, 500);
+    double answer = 0.815203;
+    ASSERT_NEAR(p, answer, abs_error);
+}
+
+TEST(Nist, linear_complexity_bitsliced_digit_e) {
+    utils::seq_bytes bytes = utils::read_bits_from_exponent();
+    double p = nist::linear_complexity(bytes, 500, nist::LinearComplexityEngine::BitSliced);
+    double answer = 0.815203;
+    ASSERT_NEAR(p, answer, abs_error);
+}
+
 TEST(Nist, serial_1) {
     utils::seq_bytes bytes = {0, 0, 1, 1, 0, 1, 1, 1, 0, 1};
     auto [p1, p2] = nist::serial_complexity(bytes, 3);
@@ -186,6 +208,15 @@ TEST(Nist, cumulative_sums_1_reverse) {
     ASSERT_NEAR(p, answer, abs_error);
 }
 
+TEST(Nist, cumulative_sums_both_digit_e) {
+    utils::seq_bytes bytes = utils::read_bits_from_exponent();
+    auto [p1, p2] = nist::cumulative_sums(bytes);
+    double answer1 = 0.672055;
+    double answer2 = 0.758083;
+    ASSERT_NEAR(p1, answer1, abs_error);
+    ASSERT_NEAR(p2, answer2, abs_error);
+}
+
 TEST(Nist, cumulative_sums_2_forward) {
     utils::seq_bytes bytes = {1, 1, 0, 0, 1, 0, 0, 1, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 0, 1, 1, 0, 1, 0, 1,
                               0, 1, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 1, 1, 0, 1, 0, 0, 0, 1, 1,
@@ -298,6 +329,24 @@ TEST(Nist, non_overlapping_template_matching_digit_e) {
     ASSERT_NEAR(p, answer, abs_error);
 }
 
+TEST(Nist, aperiodic_templates) {
+    std::vector<utils::seq_bytes> templates = nist::aperiodic_templates(9);
+    ASSERT_EQ(templates.size(), 148);
+    ASSERT_EQ(templates.front(), utils::seq_bytes({0, 0, 0, 0, 0, 0, 0, 0, 1}));
+    ASSERT_EQ(templates.back(), utils::seq_bytes({1, 1, 1, 1, 1, 1, 1, 1, 0}));
+}
+
+TEST(Nist, non_overlapping_template_matching_all_templates_digit_e) {
+    utils::seq_bytes bytes = utils::read_bits_from_exponent();
+    std::vector<utils::seq_bytes> templates = nist::aperiodic_templates(9);
+    std::vector<double> p_values = nist::non_overlapping_template_matching(bytes, templates);
+    ASSERT_EQ(p_values.size(), templates.size());
+    ASSERT_NEAR(p_values[0], 0.138094, abs_error);
+    for (size_t t = 0; t < templates.size(); t += 13) {
+        ASSERT_NEAR(p_values[t], nist::non_overlapping_template_matching(bytes, templates[t]), abs_error);
+    }
+}
+
 TEST(Nist, overlapping_template_matching_digit_e) {
     utils::seq_bytes bytes = utils::read_bits_from_exponent();
     utils::seq_bytes template_ = {1, 1, 1, 1, 1, 1, 1, 1, 1};
@@ -306,6 +355,14 @@ TEST(Nist, overlapping_template_matching_digit_e) {
     ASSERT_NEAR(p, answer, abs_error);
 }
 
+TEST(Nist, overlapping_template_matching_whole_sequence) {
+    utils::seq_bytes bytes = utils::read_bits_from_exponent();
+    utils::seq_bytes template_ = {1, 1, 1, 1, 1, 1, 1, 1, 1};
+    double p = nist::overlapping_template_matching(bytes, template_, 1032, 0);
+    ASSERT_NEAR(p, nist::overlapping_template_matching(bytes, template_, 1032, bytes.size() / 1032), abs_error);
+    ASSERT_NEAR(p, nist::overlapping_template_matching(bytes, template_, 1032, 2 * bytes.size()), abs_error);
+}
+
 TEST(Nist, universal_digit_digit_e) {
     utils::seq_bytes bytes = utils::read_bits_from_exponent();
     double p = nist::universal(bytes);
@@ -365,3 +422,29 @@ TEST(Nist, random_excursions_variant_digit_e) {
         ASSERT_NEAR(p_values[i], answers[i], abs_error);
     }
 }
+
+TEST(Nist, random_excursions_and_variant_digit_e) {
+    utils::seq_bytes bytes = utils::read_bits_from_exponent();
+    auto [p_values, p_values_variant] = nist::random_excursions_and_variant(bytes, false);
+    ASSERT_EQ(p_values, nist::random_excursions(bytes, false));
+    ASSERT_EQ(p_values_variant, nist::random_excursions_variant(bytes, false));
+}
+
+TEST(Nist, merge_equals_sequential_test) {
+    // The sequences are too short for the universal and random excursions tests, so the errors are renumbered too
+    utils::seq_bytes bytes = utils::read_bits_from_exponent(800'000);
+    std::vector<utils::seq_bytes> sequences;
+    for (size_t i = 0; i < 4; ++i) {
+        sequences.emplace_back(bytes.begin() + i * 200'000, bytes.begin() + (i + 1) * 200'000);
+    }
+    statistical_test::NistTest sequential;
+    statistical_test::NistTest first;
+    statistical_test::NistTest second;
+    for (size_t i = 0; i < sequences.size(); ++i) {
+        sequential.test(sequences[i]);
+        (i < 2 ? first : second).test(sequences[i]);
+    }
+    first.merge(second);
+    ASSERT_TRUE(first == sequential);
+    ASSERT_FALSE(second == sequential);
+}
@@ -1,8 +1,16 @@
 #include <gtest/gtest.h>
 
+#include "metrics/berlekamp_massey.hpp"
+#include "metrics/pattern_counts.hpp"
+#include "metrics/point_grid.hpp"
+#include "metrics/sequence_analysis.hpp"
+#include "metrics/thread_pool.hpp"
 #include "metrics/utils.hpp"
 
+#include <atomic>
 #include <iostream>
+#include <random>
+#include <stdexcept>
 
 TEST(Utils, can_convert_number_to_seq_bytes_1) {
     std::uint32_t number = 100U;
@@ -129,3 +137,185 @@ TEST(Utils, can_get_max_run_7) {
     size_t answer = 1;
     ASSERT_EQ(our_answer, answer);
 }
+
+TEST(Utils, can_compute_linear_complexity) {
+    utils::seq_bytes seq = {1, 1, 0, 1, 0, 1, 1, 1, 1, 0, 0, 0, 1};
+    size_t our_answer = utils::berlekamp_massey(seq, 0, seq.size());
+    size_t answer = 4;
+    ASSERT_EQ(our_answer, answer);
+}
+
+TEST(Utils, can_compute_linear_complexity_blocks) {
+    utils::seq_bytes seq = utils::read_bits_from_exponent(10'000);
+    std::vector<size_t> complexity = utils::berlekamp_massey_blocks(seq, 1000, 10);
+    for (size_t i = 0; i < complexity.size(); ++i) {
+        ASSERT_EQ(complexity[i], utils::berlekamp_massey(seq, i * 1000, 1000));
+    }
+}
+
+TEST(Utils, can_count_overlapping_patterns) {
+    utils::seq_bytes seq = {0, 0, 1, 1, 0, 1, 1, 1, 0, 1};
+    std::vector<size_t> our_answer = utils::overlapping_pattern_counts(seq, 3);
+    std::vector<size_t> answer = {0, 1, 1, 2, 1, 2, 2, 1};
+    ASSERT_EQ(our_answer, answer);
+}
+
+TEST(Utils, can_marginalize_pattern_counts) {
+    utils::seq_bytes seq = utils::read_bits_from_exponent(10'000);
+    std::vector<size_t> counts = utils::overlapping_pattern_counts(seq, 10);
+    for (size_t m = 10; m-- > 0;) {
+        counts = utils::marginalize_pattern_counts(counts);
+        ASSERT_EQ(counts, utils::overlapping_pattern_counts(seq, m));
+    }
+}
+
+TEST(Utils, can_pack_bits) {
+    utils::seq_bytes seq = utils::read_bits_from_exponent(1000);
+    std::vector<std::uint64_t> words = utils::pack_bits(seq);
+    ASSERT_EQ(words.size(), seq.size() / 64 + 2);
+    for (size_t i = 0; i < seq.size(); ++i) {
+        ASSERT_EQ((words[i / 64] >> (63 - i % 64)) & 1, seq[i]);
+    }
+    ASSERT_EQ(words[seq.size() / 64] & ((std::uint64_t(1) << (63 - seq.size() % 64)) - 1), 0);
+}
+
+TEST(Utils, can_convert_bits_to_uint) {
+    utils::seq_bytes seq = utils::read_bits_from_exponent(1000);
+    for (size_t offset = 0; offset + 64 <= seq.size(); offset += 7) {
+        std::uint64_t lsb_first = 0;
+        std::uint64_t msb_first = 0;
+        for (size_t i = 0; i < 64; ++i) {
+            lsb_first |= std::uint64_t(seq[offset + i]) << i;
+            msb_first = (msb_first << 1) | seq[offset + i];
+        }
+        ASSERT_EQ(utils::bits_to_uint<std::uint64_t>(seq, offset), lsb_first);
+        ASSERT_EQ(utils::bits_to_uint<std::uint64_t>(seq, offset, utils::BitOrder::msb_first), msb_first);
+        ASSERT_EQ(utils::bits_to_uint<std::uint32_t>(seq, offset), static_cast<std::uint32_t>(lsb_first));
+        ASSERT_EQ(utils::bits_to_uint<std::uint8_t>(seq, offset, utils::BitOrder::msb_first), msb_first >> 56);
+    }
+}
+
+TEST(Utils, can_convert_bits_to_doubles) {
+    utils::seq_bytes seq(64 * 3, 1);
+    std::fill(seq.begin() + 64, seq.end(), 0);
+    seq[128 + 63] = 1;
+    std::vector<double> doubles = utils::bits_to_doubles(seq, 3);
+    ASSERT_EQ(doubles[0], 1.0 - std::ldexp(1.0, -52));
+    ASSERT_EQ(doubles[1], 0.0);
+    ASSERT_EQ(doubles[2], 0.5);
+    ASSERT_EQ(utils::bits_to_doubles(seq, 3, utils::BitOrder::msb_first)[2], 0.0);
+}
+
+TEST(Utils, sequence_analysis_matches_direct_computation) {
+    utils::seq_bytes seq = utils::read_bits_from_exponent(10'000);
+    utils::SequenceAnalysis analysis(seq);
+    size_t ones = 0;
+    for (unsigned char bit : seq) {
+        ones += bit;
+    }
+    ASSERT_EQ(analysis.ones(), ones);
+    ASSERT_EQ(analysis.packed_bits(), utils::pack_bits(seq));
+    ASSERT_EQ(analysis.pattern_counts(12), utils::overlapping_pattern_counts(seq, 12));
+    ASSERT_EQ(analysis.pattern_counts(9), utils::overlapping_pattern_counts(seq, 9));
+    ASSERT_EQ(analysis.pattern_counts(8), utils::overlapping_pattern_counts(seq, 8));
+    analysis.release_pattern_counts();
+    ASSERT_EQ(analysis.pattern_counts(3), utils::overlapping_pattern_counts(seq, 3));
+}
+
+TEST(Utils, thread_pool_runs_nested_parallel_for) {
+    utils::ThreadPool pool(4);
+    std::vector<std::atomic<size_t>> visits(1000);
+    pool.parallel_for(10, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i) {
+            pool.parallel_for(100, [&](size_t inner_first, size_t inner_last) {
+                for (size_t j = inner_first; j < inner_last; ++j) {
+                    visits[i * 100 + j]++;
+                }
+            });
+        }
+    });
+    for (const auto &visit : visits) {
+        ASSERT_EQ(visit.load(), 1);
+    }
+}
+
+TEST(Utils, task_graph_respects_dependencies) {
+    utils::ThreadPool pool(3);
+    std::vector<size_t> order;
+    std::mutex mutex;
+    auto record = [&](size_t id) {
+        return [&, id] {
+            std::lock_guard<std::mutex> lock(mutex);
+            order.push_back(id);
+        };
+    };
+    utils::TaskGraph graph;
+    size_t first = graph.add(record(0));
+    size_t second = graph.add(record(1), {first});
+    graph.add(record(2), {first, second});
+    graph.run(0, pool);
+    ASSERT_EQ(order, std::vector<size_t>({0, 1, 2}));
+}
+
+TEST(Utils, task_group_rethrows_exception) {
+    utils::ThreadPool pool(2);
+    utils::TaskGroup group(pool);
+    group.run([] { throw std::runtime_error("task failed"); });
+    ASSERT_THROW(group.wait(), std::runtime_error);
+}
+
+TEST(Utils, closest_pair_matches_brute_force) {
+    std::mt19937_64 generator(7);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    for (size_t sample = 0; sample < 20; ++sample) {
+        std::vector<std::array<double, 3>> points(300);
+        for (auto &point : points) {
+            point = {uniform(generator), uniform(generator), uniform(generator)};
+            // Points on a plane leave most cells of the grid empty
+            if (sample % 2 == 1) {
+                point[2] = 0.5;
+            }
+        }
+        double best = std::numeric_limits<double>::infinity();
+        for (size_t i = 0; i < points.size(); ++i) {
+            for (size_t j = i + 1; j < points.size(); ++j) {
+                double distance = 0;
+                for (size_t d = 0; d < 3; ++d) {
+                    distance += (points[i][d] - points[j][d]) * (points[i][d] - points[j][d]);
+                }
+                best = std::min(best, distance);
+            }
+        }
+        ASSERT_DOUBLE_EQ(utils::closest_pair_squared(points, 1.0), best);
+    }
+}
+
+TEST(Utils, incremental_grid_matches_brute_force) {
+    std::mt19937_64 generator(11);
+    std::uniform_real_distribution<double> uniform(0.0, 20.0);
+    for (utils::Norm norm : {utils::Norm::euclidean, utils::Norm::maximum}) {
+        utils::IncrementalPointGrid<2> grid(20.0, 20);
+        std::vector<std::array<double, 2>> inserted;
+        for (size_t i = 0; i < 2000; ++i) {
+            std::array<double, 2> point = {uniform(generator), uniform(generator)};
+            bool near = false;
+            for (const auto &other : inserted) {
+                double dx = std::abs(point[0] - other[0]);
+                double dy = std::abs(point[1] - other[1]);
+                near = near || (norm == utils::Norm::maximum ? std::max(dx, dy) <= 1.0 : dx * dx + dy * dy <= 1.0);
+            }
+            ASSERT_EQ(grid.has_point_within(point, 1.0, norm), near);
+            if (!near) {
+                grid.insert(point);
+                inserted.push_back(point);
+            }
+        }
+        ASSERT_EQ(grid.size(), inserted.size());
+    }
+}
+
+TEST(Utils, kstest_does_not_depend_on_order) {
+    std::vector<double> p_values = {0.91, 0.12, 0.55, 0.33, 0.78};
+    std::vector<double> sorted = {0.12, 0.33, 0.55, 0.78, 0.91};
+    ASSERT_EQ(utils::kstest(p_values), utils::kstest(sorted));
+}